@@ -0,0 +1,144 @@
+/* Project ........ Python Game Engine
+ * Filename ....... assetcheck.c
+ * Description .... Checks the asset cache: identical files share one reference-counted copy, and
+ *                  budgets evict the least recently used assets, which reload when used again.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -o assetcheck assetcheck.c assets.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "imports.h"
+#include "meshfile.h"
+#include "assets.h"
+
+
+static int failures = 0;
+static int checks = 0;
+
+
+static void check(const char name[], bool ok, const char detail[])
+{
+    printf("%-38s %s  %s\n", name, ok ? "ok  " : "FAIL", detail);
+    failures += !ok;
+    checks++;
+}
+
+
+static std::string copy_to_temp(const char filename[], const char suffix[])
+{
+    // A second path holding the same bytes, so only the content can match.
+    std::string path = std::string("/tmp/assetcheck_XXXXXX") + suffix;
+    int fd = mkstemps(&path[0], strlen(suffix));
+    if (fd < 0) return "";
+    FILE* dst = fdopen(fd, "wb");
+    FILE* src = fopen(filename, "rb");
+    char buffer[65536];
+    size_t n;
+    while (src && (n = fread(buffer, 1, sizeof(buffer), src)) > 0) fwrite(buffer, 1, n, dst);
+    if (src) fclose(src);
+    fclose(dst);
+    return src ? path : "";
+}
+
+
+static void check_shared(int type, const char filename[], const char suffix[])
+{
+    AssetCache* cache = default_asset_cache();
+    const char* kind = type == ASSET_MESH ? "mesh" : "texture";
+    std::string a = copy_to_temp(filename, suffix), b = copy_to_temp(filename, suffix);
+    char name[64], detail[128];
+    if (a.empty() || b.empty()) {
+        snprintf(name, sizeof(name), "%s copies", kind);
+        check(name, false, "could not copy the source to /tmp");
+        return;
+    }
+
+    // Both paths resolve to one entry holding two references.
+    void* first = type == ASSET_MESH ? (void*) acquire_mesh(a.c_str(), MESH_OPTIMIZE_ORDER) : (void*) acquire_texture(a.c_str());
+    size_t bytes = asset_resident_bytes(type);
+    void* second = type == ASSET_MESH ? (void*) acquire_mesh(b.c_str(), MESH_OPTIMIZE_ORDER) : (void*) acquire_texture(b.c_str());
+    snprintf(name, sizeof(name), "%s shared under two paths", kind);
+    snprintf(detail, sizeof(detail), "%lu resident, %.2f MB before and %.2f MB after the second path", cache->resident_count[type],
+             bytes / 1048576.0, asset_resident_bytes(type) / 1048576.0);
+    check(name, first && first == second && cache->resident_count[type] == 1 && asset_resident_bytes(type) == bytes, detail);
+
+    // The copy outlives the first release and goes with the last.
+    if (type == ASSET_MESH) release_mesh((Mesh*) first);
+    else release_texture((Texture*) first);
+    snprintf(name, sizeof(name), "%s kept after one release", kind);
+    snprintf(detail, sizeof(detail), "%lu resident", cache->resident_count[type]);
+    check(name, cache->resident_count[type] == 1 && asset_resident_bytes(type) == bytes, detail);
+    if (type == ASSET_MESH) release_mesh((Mesh*) second);
+    else release_texture((Texture*) second);
+    snprintf(name, sizeof(name), "%s freed after the last release", kind);
+    snprintf(detail, sizeof(detail), "%lu resident, %zu bytes", cache->resident_count[type], asset_resident_bytes(type));
+    check(name, cache->resident_count[type] == 0 && asset_resident_bytes(type) == 0, detail);
+
+    std::string paths[2] = {a, b};
+    for (int i = 0; i < 2; i++) {
+        unlink(paths[i].c_str());
+        if (type == ASSET_MESH) unlink(mesh_cache_filename(paths[i].c_str(), MESH_OPTIMIZE_ORDER).c_str());
+    }
+}
+
+
+static void check_eviction(const char filename_a[], const char filename_b[])
+{
+    // Two textures over a budget that holds either one but not both.
+    AssetCache* cache = default_asset_cache();
+    Texture* a = acquire_texture(filename_a);
+    Texture* b = acquire_texture(filename_b);
+    char detail[128];
+    if (!a || !b) {
+        check("texture eviction", false, "could not load the textures");
+        if (a) release_texture(a);
+        if (b) release_texture(b);
+        return;
+    }
+    unsigned int width_a = a->width, width_b = b->width;
+    size_t bytes = asset_resident_bytes(ASSET_TEXTURE);
+    unsigned long evictions = cache->evictions[ASSET_TEXTURE];
+    update_assets();    // Both count as used in the frame that loaded them.
+    set_asset_budget(ASSET_TEXTURE, bytes - 1);
+
+    // A frame that draws only A evicts B, as it was not used this frame.
+    Object obj_a = {NULL, a}, obj_b = {NULL, b};
+    use_object(&obj_a);
+    update_assets();
+    snprintf(detail, sizeof(detail), "%ux%u, %.2f of %.2f MB resident", b->width, b->height,
+             asset_resident_bytes(ASSET_TEXTURE) / 1048576.0, bytes / 1048576.0);
+    check("unused texture evicted", (size_t) b->width * b->height <= ASSET_EVICTED_TEXELS && a->width == width_a &&
+          cache->evictions[ASSET_TEXTURE] == evictions + 1, detail);
+
+    // Drawing B reloads it in the background, and A is now the least recently used.
+    use_object(&obj_b);
+    wait_asset_jobs(default_asset_loader());
+    update_assets();
+    snprintf(detail, sizeof(detail), "%ux%u reloaded, other texture %ux%u", b->width, b->height, a->width, a->height);
+    check("evicted texture reloaded on use", b->width == width_b, detail);
+    check("least recently used evicted next", (size_t) a->width * a->height <= ASSET_EVICTED_TEXELS &&
+          cache->evictions[ASSET_TEXTURE] == evictions + 2, detail);
+
+    set_asset_budget(ASSET_TEXTURE, 0);
+    release_texture(a);
+    release_texture(b);
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        printf("usage: %s\n", argv[0]);
+        return 1;
+    }
+    check_shared(ASSET_MESH, "models/Scene2.obj", ".obj");
+    check_shared(ASSET_TEXTURE, "textures/Scene1.png", ".png");
+    check_eviction("textures/Scene1.png", "textures/Scene2_baked.png");
+    printf("%d of %d checks failed\n", failures, checks);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,529 @@
+/* Project ........ Python Game Engine
+ * Filename ....... assets.c
+ * Description .... Asynchronous asset loading and a shared, reference-counted asset cache
+ *                  with per-type memory budgets.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include <limits.h>
+#include <sys/stat.h>
+#include "types.h"
+#include "imports.h"
+#include "meshfile.h"
+#include "vtexture.h"
+#include "jobs.h"
+#include "assets.h"
+#include "profiler.h"
+
+
+static void worker_main(AssetLoader* loader)
+{
+    PROFILE_THREAD("asset worker");
+    set_job_background(true);
+    std::unique_lock<std::mutex> guard(loader->lock);
+    while (true) {
+        loader->wake.wait(guard, [loader] { return loader->stop || !loader->jobs.empty(); });
+        if (loader->jobs.empty()) return;
+        std::function<void()> job = loader->jobs.front();
+        loader->jobs.pop_front();
+        loader->busy++;
+        guard.unlock();
+
+        {
+            PROFILE_ZONE("asset job");
+            job();
+        }
+
+        guard.lock();
+        loader->busy--;
+        loader->done.notify_all();
+    }
+}
+
+
+AssetLoader* create_asset_loader(unsigned int num_workers)
+{
+    AssetLoader* loader = new AssetLoader();
+    loader->busy = 0;
+    loader->stop = false;
+    for (unsigned int i = 0; i < num_workers; i++) {
+        loader->workers.push_back(std::thread(worker_main, loader));
+    }
+    return loader;
+}
+
+
+AssetLoader* default_asset_loader()
+{
+    // At least two workers so mesh parsing and texture decoding overlap.
+    static AssetLoader* loader = create_asset_loader(std::max(2u, std::thread::hardware_concurrency()));
+    return loader;
+}
+
+
+void destroy_asset_loader(AssetLoader* loader)
+{
+    // Queued jobs are finished before the workers exit.
+    {
+        std::lock_guard<std::mutex> guard(loader->lock);
+        loader->stop = true;
+    }
+    loader->wake.notify_all();
+    for (size_t i = 0; i < loader->workers.size(); i++) loader->workers[i].join();
+    delete loader;
+}
+
+
+void submit_asset_job(AssetLoader* loader, std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(loader->lock);
+        loader->jobs.push_back(job);
+    }
+    loader->wake.notify_one();
+}
+
+
+void wait_asset_jobs(AssetLoader* loader)
+{
+    std::unique_lock<std::mutex> guard(loader->lock);
+    loader->done.wait(guard, [loader] { return loader->jobs.empty() && loader->busy == 0; });
+}
+
+
+AsyncObject* load_object_async(const char filename[], const char tex_filename[], unsigned int mesh_flags)
+{
+    AsyncObject* handle = new AsyncObject();
+    handle->mesh = NULL;
+    handle->texture = NULL;
+    handle->pending = 2;
+    handle->failed = false;
+
+    // Parse the mesh and decode the texture as two independent jobs.
+    AssetLoader* loader = default_asset_loader();
+    std::string mesh_filename = filename;
+    std::string texture_filename = tex_filename;
+    submit_asset_job(loader, [handle, mesh_filename, mesh_flags] {
+        handle->mesh = acquire_mesh(mesh_filename.c_str(), mesh_flags);
+        if (!handle->mesh) {
+            fprintf(stderr, "Could not load mesh %s in the background\n", mesh_filename.c_str());
+            handle->failed = true;
+        }
+        handle->pending--;
+    });
+    submit_asset_job(loader, [handle, texture_filename] {
+        handle->texture = acquire_texture(texture_filename.c_str());
+        if (!handle->texture) {
+            fprintf(stderr, "Could not load texture %s in the background\n", texture_filename.c_str());
+            handle->failed = true;
+        }
+        handle->pending--;
+    });
+    return handle;
+}
+
+
+bool object_ready(AsyncObject* handle)
+{
+    return handle->pending == 0;
+}
+
+
+bool object_failed(AsyncObject* handle)
+{
+    // Placeholders from current_object stand in for failed assets for good.
+    return handle->failed;
+}
+
+
+Object wait_object(AsyncObject* handle)
+{
+    AssetLoader* loader = default_asset_loader();
+    {
+        std::unique_lock<std::mutex> guard(loader->lock);
+        loader->done.wait(guard, [handle] { return handle->pending == 0; });
+    }
+    Object obj;
+    obj.mesh = handle->mesh;
+    obj.texture = handle->texture;
+    return obj;
+}
+
+
+static Mesh* placeholder_mesh()
+{
+    static Mesh* mesh = create_mesh(0, 0);
+    return mesh;
+}
+
+
+static Texture* placeholder_texture()
+{
+    // Single mid-grey texel (plus the padding byte packet shading expects).
+    static uint8_t data[4] = {128, 128, 128, 0};
+    static Texture tex = {1, 1, data, NULL};
+    return &tex;
+}
+
+
+Object current_object(AsyncObject* handle)
+{
+    // Stand in for assets that are still loading, so the object can be drawn right away.
+    Object obj;
+    obj.mesh = handle->mesh;
+    obj.texture = handle->texture;
+    if (!obj.mesh) obj.mesh = placeholder_mesh();
+    if (!obj.texture) obj.texture = placeholder_texture();
+    return obj;
+}
+
+
+void release_async_object(AsyncObject* handle)
+{
+    Object obj = wait_object(handle);
+    release_object(&obj);
+    delete handle;
+}
+
+
+AssetCache* default_asset_cache()
+{
+    static AssetCache* cache = new AssetCache();
+    return cache;
+}
+
+
+static std::string path_key(int type, unsigned int flags, const char filename[])
+{
+    // Canonicalise the path so different spellings of one file share an entry.
+    char resolved[PATH_MAX];
+    const char* path = realpath(filename, resolved) ? resolved : filename;
+    return std::to_string(type) + ":" + std::to_string(flags) + ":" + path;
+}
+
+
+static uint64_t file_checksum(AssetCache* cache, const char filename[])
+{
+    // Hashing reads the whole file, which is gigabytes for large paged textures.
+    // Hashes are kept per device, inode, size and modification time, so a file
+    // is only read again once it has changed.
+    struct stat st;
+    if (stat(filename, &st) != 0) return checksum_file(filename);
+    std::string identity = std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" + std::to_string(st.st_size)
+                           + ":" + std::to_string((int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec);
+    {
+        std::lock_guard<std::mutex> guard(cache->lock);
+        std::unordered_map<std::string, uint64_t>::iterator it = cache->checksums.find(identity);
+        if (it != cache->checksums.end()) return it->second;
+    }
+    uint64_t checksum = checksum_file(filename);
+    std::lock_guard<std::mutex> guard(cache->lock);
+    cache->checksums[identity] = checksum;
+    return checksum;
+}
+
+
+static uint64_t content_key(int type, unsigned int flags, uint64_t checksum)
+{
+    // Fold type and load flags into the content hash (FNV-1a style).
+    uint64_t key = checksum;
+    key = (key ^ (uint64_t) type) * 1099511628211ull;
+    key = (key ^ (uint64_t) flags) * 1099511628211ull;
+    return key;
+}
+
+
+static size_t asset_bytes(int type, void* data)
+{
+    if (type == ASSET_MESH) return ((Mesh*) data)->storage_size;
+    Texture* tex = (Texture*) data;
+    if (tex->virt) return (size_t) tex->virt->num_tiles * (sizeof(int) + sizeof(uint8_t) + sizeof(uint32_t));
+    return (size_t) tex->width * tex->height * 3 + 1;
+}
+
+
+static void free_asset(int type, void* data)
+{
+    if (type == ASSET_MESH) free_mesh((Mesh*) data);
+    else free_texture((Texture*) data);
+}
+
+
+static void* acquire_asset(int type, const char filename[], unsigned int flags)
+{
+    AssetCache* cache = default_asset_cache();
+    std::string key = path_key(type, flags, filename);
+    {
+        std::lock_guard<std::mutex> guard(cache->lock);
+        std::unordered_map<std::string, AssetEntry*>::iterator it = cache->by_path.find(key);
+        if (it != cache->by_path.end()) {
+            it->second->refs++;
+            return it->second->data;
+        }
+    }
+
+    // Unknown path: the same content may already be resident under another name.
+    uint64_t ckey = content_key(type, flags, file_checksum(cache, filename));
+    {
+        std::lock_guard<std::mutex> guard(cache->lock);
+        std::unordered_map<uint64_t, AssetEntry*>::iterator it = cache->by_content.find(ckey);
+        if (it != cache->by_content.end()) {
+            AssetEntry* entry = it->second;
+            entry->refs++;
+            if (!cache->by_path.count(key)) {
+                entry->path_keys.push_back(key);
+                cache->by_path[key] = entry;
+            }
+            return entry->data;
+        }
+    }
+
+    // Load outside the lock so other assets can be served meanwhile.
+    void* data = type == ASSET_MESH ? (void*) load_mesh_cached(filename, flags) : (void*) load_texture(filename);
+    if (!data) return NULL;
+
+    std::lock_guard<std::mutex> guard(cache->lock);
+    std::unordered_map<uint64_t, AssetEntry*>::iterator it = cache->by_content.find(ckey);
+    if (it != cache->by_content.end()) {
+        // Another thread loaded the same content first; use its copy.
+        free_asset(type, data);
+        AssetEntry* entry = it->second;
+        entry->refs++;
+        if (!cache->by_path.count(key)) {
+            entry->path_keys.push_back(key);
+            cache->by_path[key] = entry;
+        }
+        return entry->data;
+    }
+    AssetEntry* entry = new AssetEntry();
+    entry->type = type;
+    entry->flags = flags;
+    entry->data = data;
+    entry->bytes = asset_bytes(type, data);
+    entry->refs = 1;
+    entry->content_key = ckey;
+    entry->path_keys.push_back(key);
+    entry->filename = filename;
+    entry->state = ASSET_RESIDENT;
+    entry->last_used = cache->frame;
+    entry->staged = NULL;
+    cache->by_path[key] = entry;
+    cache->by_content[ckey] = entry;
+    cache->by_data[data] = entry;
+    cache->resident_bytes[type] += entry->bytes;
+    cache->resident_count[type]++;
+    return data;
+}
+
+
+static void release_asset(void* data)
+{
+    if (!data) return;
+    AssetCache* cache = default_asset_cache();
+    std::unique_lock<std::mutex> guard(cache->lock);
+    std::unordered_map<void*, AssetEntry*>::iterator it = cache->by_data.find(data);
+    if (it == cache->by_data.end()) {
+        fprintf(stderr, "Released an asset not owned by the asset cache\n");
+        return;
+    }
+    AssetEntry* entry = it->second;
+    if (--entry->refs > 0) return;
+
+    // Last reference dropped: forget every alias and free the data.
+    for (size_t i = 0; i < entry->path_keys.size(); i++) cache->by_path.erase(entry->path_keys[i]);
+    cache->by_content.erase(entry->content_key);
+    cache->by_data.erase(it);
+    cache->resident_bytes[entry->type] -= entry->bytes;
+    cache->resident_count[entry->type]--;
+    guard.unlock();
+
+    free_asset(entry->type, entry->data);
+    if (entry->staged) free_asset(entry->type, entry->staged);
+    delete entry;
+}
+
+
+Mesh* acquire_mesh(const char filename[], unsigned int flags)
+{
+    return (Mesh*) acquire_asset(ASSET_MESH, filename, flags);
+}
+
+
+Texture* acquire_texture(const char filename[])
+{
+    return (Texture*) acquire_asset(ASSET_TEXTURE, filename, 0);
+}
+
+
+Object acquire_object(const char filename[], const char tex_filename[], unsigned int mesh_flags)
+{
+    Object obj;
+    obj.mesh = acquire_mesh(filename, mesh_flags);
+    obj.texture = acquire_texture(tex_filename);
+    return obj;
+}
+
+
+void release_mesh(Mesh* mesh)
+{
+    release_asset(mesh);
+}
+
+
+void release_texture(Texture* tex)
+{
+    release_asset(tex);
+}
+
+
+void release_object(Object* obj)
+{
+    release_mesh(obj->mesh);
+    release_texture(obj->texture);
+    obj->mesh = NULL;
+    obj->texture = NULL;
+}
+
+
+size_t asset_resident_bytes(int type)
+{
+    AssetCache* cache = default_asset_cache();
+    std::lock_guard<std::mutex> guard(cache->lock);
+    return cache->resident_bytes[type];
+}
+
+
+void print_asset_report(FILE* file)
+{
+    static const char* names[ASSET_NUM_TYPES] = {"meshes", "textures"};
+    AssetCache* cache = default_asset_cache();
+    std::lock_guard<std::mutex> guard(cache->lock);
+    for (int t = 0; t < ASSET_NUM_TYPES; t++) {
+        fprintf(file, "%-10s %6lu resident %10.2f MB %8lu evictions\n", names[t], cache->resident_count[t],
+               cache->resident_bytes[t] / 1048576.0, cache->evictions[t]);
+    }
+}
+
+
+void set_asset_budget(int type, size_t bytes)
+{
+    AssetCache* cache = default_asset_cache();
+    std::lock_guard<std::mutex> guard(cache->lock);
+    cache->budget[type] = bytes;
+}
+
+
+static void touch_asset(AssetCache* cache, void* data)
+{
+    std::unordered_map<void*, AssetEntry*>::iterator it = cache->by_data.find(data);
+    if (it == cache->by_data.end()) return;
+    AssetEntry* entry = it->second;
+    entry->last_used = cache->frame;
+    if (entry->state != ASSET_EVICTED) return;
+
+    // Reload in the background; the job holds a reference so the entry outlives it.
+    entry->state = ASSET_RELOADING;
+    entry->refs++;
+    submit_asset_job(default_asset_loader(), [cache, entry] {
+        void* reloaded = entry->type == ASSET_MESH ? (void*) load_mesh_cached(entry->filename.c_str(), entry->flags)
+                                                   : (void*) load_texture(entry->filename.c_str());
+        {
+            std::lock_guard<std::mutex> guard(cache->lock);
+            entry->staged = reloaded;
+            if (!reloaded) entry->state = ASSET_EVICTED;
+        }
+        release_asset(entry->data);
+    });
+}
+
+
+void use_object(Object* obj)
+{
+    // Mark the object's assets as in use this frame, bringing evicted ones back.
+    AssetCache* cache = default_asset_cache();
+    std::lock_guard<std::mutex> guard(cache->lock);
+    touch_asset(cache, obj->mesh);
+    touch_asset(cache, obj->texture);
+}
+
+
+static void evict_asset(AssetCache* cache, AssetEntry* entry)
+{
+    // The Mesh or Texture itself stays valid for holders; only its contents shrink.
+    if (entry->type == ASSET_MESH) {
+        Mesh* mesh = (Mesh*) entry->data;
+        Mesh* empty = create_mesh(0, 0);
+        std::swap(*mesh, *empty);
+        free_mesh(empty);
+    } else {
+        Texture* tex = (Texture*) entry->data;
+        unsigned int w = tex->width, h = tex->height;
+        uint8_t* data = tex->data;
+        while ((size_t) w * h > ASSET_EVICTED_TEXELS) {
+            uint8_t* half = downsample_rgb(data, w, h, &w, &h);
+            if (data != tex->data) free(data);
+            data = half;
+        }
+        if (data != tex->data) free(tex->data);
+        tex->data = data;
+        tex->width = w;
+        tex->height = h;
+    }
+    cache->resident_bytes[entry->type] -= entry->bytes;
+    entry->bytes = asset_bytes(entry->type, entry->data);
+    cache->resident_bytes[entry->type] += entry->bytes;
+    entry->state = ASSET_EVICTED;
+    cache->evictions[entry->type]++;
+}
+
+
+static void commit_reload(AssetCache* cache, AssetEntry* entry)
+{
+    // Swap the reloaded contents in and free the evicted ones with the temporary.
+    if (entry->type == ASSET_MESH) {
+        std::swap(*(Mesh*) entry->data, *(Mesh*) entry->staged);
+    } else {
+        Texture* tex = (Texture*) entry->data;
+        Texture* staged = (Texture*) entry->staged;
+        std::swap(tex->data, staged->data);
+        std::swap(tex->width, staged->width);
+        std::swap(tex->height, staged->height);
+    }
+    free_asset(entry->type, entry->staged);
+    entry->staged = NULL;
+    cache->resident_bytes[entry->type] -= entry->bytes;
+    entry->bytes = asset_bytes(entry->type, entry->data);
+    cache->resident_bytes[entry->type] += entry->bytes;
+    entry->state = ASSET_RESIDENT;
+}
+
+
+void update_assets()
+{
+    // Called once per frame between draws, as it changes asset contents in place.
+    PROFILE_ZONE("update assets");
+    AssetCache* cache = default_asset_cache();
+    std::lock_guard<std::mutex> guard(cache->lock);
+    std::vector<AssetEntry*> entries;
+    for (std::unordered_map<void*, AssetEntry*>::iterator it = cache->by_data.begin(); it != cache->by_data.end(); it++) {
+        if (it->second->staged) commit_reload(cache, it->second);
+        entries.push_back(it->second);
+    }
+
+    // Evict least recently used assets not drawn this frame until each type fits its budget.
+    std::sort(entries.begin(), entries.end(), [](AssetEntry* a, AssetEntry* b) { return a->last_used < b->last_used; });
+    for (size_t i = 0; i < entries.size(); i++) {
+        AssetEntry* entry = entries[i];
+        int type = entry->type;
+        if (!cache->budget[type] || cache->resident_bytes[type] <= cache->budget[type]) continue;
+        if (entry->last_used >= cache->frame || entry->state != ASSET_RESIDENT) continue;
+        if (type == ASSET_TEXTURE && ((Texture*) entry->data)->virt) continue;
+        evict_asset(cache, entry);
+    }
+    cache->frame++;
+}
@@ -0,0 +1,129 @@
+#ifndef _ASSETS_H_
+#define _ASSETS_H_
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "types.h"
+
+
+#define ASSET_MESH 0
+#define ASSET_TEXTURE 1
+#define ASSET_NUM_TYPES 2
+
+#define ASSET_RESIDENT 0
+#define ASSET_EVICTED 1                 // Texture dropped to a low mip, or mesh emptied.
+#define ASSET_RELOADING 2
+
+#define ASSET_EVICTED_TEXELS (64 * 64)  // Largest mip kept for an evicted texture.
+
+
+// Background I/O pool running asset loading jobs.
+struct AssetLoader {
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::deque<std::function<void()> > jobs;
+    unsigned int busy;
+    bool stop;
+};
+
+
+// Object whose mesh and texture are loaded concurrently in the background.
+// Each pointer stays NULL until the corresponding asset is resident, and for
+// good if it could not be loaded.
+struct AsyncObject {
+    std::atomic<Mesh*> mesh;
+    std::atomic<Texture*> texture;
+    std::atomic<int> pending;
+    std::atomic<bool> failed;       // Set before pending drops, so it is final once ready.
+};
+
+
+// Shared, reference-counted resource. Every path it was requested under maps
+// to it, as does the hash of its file content, so identical files share one copy.
+struct AssetEntry {
+    int type;
+    unsigned int flags;
+    void* data;                     // Mesh* or Texture*.
+    size_t bytes;
+    unsigned int refs;
+    uint64_t content_key;
+    std::vector<std::string> path_keys;
+    std::string filename;           // Path to reload from after eviction.
+    uint8_t state;
+    uint32_t last_used;             // Frame in which an object using it was last drawn.
+    void* staged;                   // Reloaded data waiting to be swapped in.
+};
+
+
+struct AssetCache {
+    std::mutex lock;
+    std::unordered_map<std::string, AssetEntry*> by_path;
+    std::unordered_map<uint64_t, AssetEntry*> by_content;
+    std::unordered_map<void*, AssetEntry*> by_data;
+    std::unordered_map<std::string, uint64_t> checksums;   // Content hash per file identity (see file_checksum).
+    size_t resident_bytes[ASSET_NUM_TYPES];
+    unsigned long resident_count[ASSET_NUM_TYPES];
+    size_t budget[ASSET_NUM_TYPES];     // 0 means unlimited.
+    unsigned long evictions[ASSET_NUM_TYPES];
+    uint32_t frame;
+};
+
+
+AssetLoader* create_asset_loader(unsigned int num_workers);
+
+AssetLoader* default_asset_loader();
+
+void destroy_asset_loader(AssetLoader* loader);
+
+void submit_asset_job(AssetLoader* loader, std::function<void()> job);
+
+void wait_asset_jobs(AssetLoader* loader);
+
+AsyncObject* load_object_async(const char filename[], const char tex_filename[], unsigned int mesh_flags = 0);
+
+bool object_ready(AsyncObject* handle);
+
+bool object_failed(AsyncObject* handle);
+
+Object wait_object(AsyncObject* handle);
+
+Object current_object(AsyncObject* handle);
+
+void release_async_object(AsyncObject* handle);
+
+AssetCache* default_asset_cache();
+
+Mesh* acquire_mesh(const char filename[], unsigned int flags = 0);
+
+Texture* acquire_texture(const char filename[]);
+
+Object acquire_object(const char filename[], const char tex_filename[], unsigned int mesh_flags = 0);
+
+void release_mesh(Mesh* mesh);
+
+void release_texture(Texture* tex);
+
+void release_object(Object* obj);
+
+size_t asset_resident_bytes(int type);
+
+void set_asset_budget(int type, size_t bytes);
+
+void use_object(Object* obj);
+
+void update_assets();
+
+void print_asset_report(FILE* file);
+
+
+#endif
@@ -0,0 +1,246 @@
+/* Project ........ Python Game Engine
+ * Filename ....... backend.c
+ * Description .... Presentation backends: a GLFW window or headless file output.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#ifndef NO_GLFW
+#include <GLFW/glfw3.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "types.h"
+#include "backend.h"
+#include "profiler.h"
+
+
+Backend* create_window_backend(int width, int height, const char title[])
+{
+#ifdef NO_GLFW
+    fprintf(stderr, "Built without GLFW; only the headless backend is available\n");
+    return NULL;
+#else
+    // Initialize the library and create the window.
+    if (!glfwInit()) return NULL;
+    GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
+    if (!window) {
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
+
+    Backend* backend = new Backend();
+    backend->type = BACKEND_WINDOW;
+    backend->width = width;
+    backend->height = height;
+    backend->window = window;
+    backend->output = OUTPUT_NONE;
+    return backend;
+#endif
+}
+
+
+Backend* create_headless_backend(int width, int height, int output, const char prefix[], unsigned long max_frames)
+{
+    Backend* backend = new Backend();
+    backend->type = BACKEND_HEADLESS;
+    backend->width = width;
+    backend->height = height;
+    backend->output = output;
+    snprintf(backend->prefix, sizeof(backend->prefix), "%s", prefix);
+    backend->max_frames = max_frames;
+    if (output != OUTPUT_NONE) backend->scratch = new uint8_t[(size_t) width * height * 3];
+
+    // Raw frames go to a single stream ("-" for stdout), e.g. to pipe into an encoder.
+    if (output == OUTPUT_RAW) {
+        std::string filename = std::string(prefix) + ".raw";
+        if (strcmp(prefix, "-") == 0) {
+            // Frames take over the original stdout. Everything else printed to stdout
+            // (loader progress, frame rates), including output still buffered, goes
+            // to stderr from here on, so it cannot end up in the stream.
+            int fd = dup(STDOUT_FILENO);
+            backend->raw = fd >= 0 ? fdopen(fd, "wb") : NULL;
+            if (backend->raw) dup2(STDERR_FILENO, STDOUT_FILENO);
+            filename = "stdout";
+        } else {
+            backend->raw = fopen(filename.c_str(), "wb");
+        }
+        if (!backend->raw) {
+            fprintf(stderr, "Could not open %s\n", filename.c_str());
+            destroy_backend(backend);
+            return NULL;
+        }
+    }
+    return backend;
+}
+
+
+int parse_output_format(const char name[])
+{
+    if (strcmp(name, "none") == 0) return OUTPUT_NONE;
+    if (strcmp(name, "ppm") == 0) return OUTPUT_PPM;
+    if (strcmp(name, "png") == 0) return OUTPUT_PNG;
+    if (strcmp(name, "raw") == 0) return OUTPUT_RAW;
+    return -1;
+}
+
+
+bool backend_running(Backend* backend)
+{
+#ifndef NO_GLFW
+    if (backend->type == BACKEND_WINDOW) return !glfwWindowShouldClose((GLFWwindow*) backend->window);
+#endif
+    return !backend->max_frames || backend->frame < backend->max_frames;
+}
+
+
+void present_frame(Backend* backend, Camera* cam)
+{
+    PROFILE_ZONE("present");
+#ifndef NO_GLFW
+    if (backend->type == BACKEND_WINDOW) {
+        // Swap front and back buffers.
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawPixels(backend->width, backend->height, GL_RGB, GL_UNSIGNED_BYTE, cam->frame_buffer);
+        glfwSwapBuffers((GLFWwindow*) backend->window);
+
+        // Poll for and process events.
+        glfwPollEvents();
+        backend->frame++;
+        return;
+    }
+#endif
+    if (backend->output != OUTPUT_NONE) {
+        // Files are top-down while the frame buffer is bottom-up (as glDrawPixels expects).
+        size_t stride = (size_t) backend->width * 3;
+        for (int y = 0; y < backend->height; y++) {
+            memcpy(backend->scratch + y * stride, cam->frame_buffer + (backend->height - 1 - y) * stride, stride);
+        }
+        char filename[300];
+        if (backend->output == OUTPUT_PPM) {
+            snprintf(filename, sizeof(filename), "%s_%05lu.ppm", backend->prefix, backend->frame);
+            write_ppm(filename, backend->scratch, backend->width, backend->height);
+        } else if (backend->output == OUTPUT_PNG) {
+            snprintf(filename, sizeof(filename), "%s_%05lu.png", backend->prefix, backend->frame);
+            write_png(filename, backend->scratch, backend->width, backend->height);
+        } else {
+            fwrite(backend->scratch, 1, stride * backend->height, backend->raw);
+        }
+    }
+    backend->frame++;
+}
+
+
+void destroy_backend(Backend* backend)
+{
+#ifndef NO_GLFW
+    if (backend->type == BACKEND_WINDOW) glfwTerminate();
+#endif
+    if (backend->raw) fclose(backend->raw);
+    delete[] backend->scratch;
+    delete backend;
+}
+
+
+int write_ppm(const char filename[], const uint8_t* rgb, int width, int height)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file) return -1;
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    bool ok = fwrite(rgb, (size_t) width * 3, height, file) == (size_t) height;
+    return (fclose(file) == 0 && ok) ? 0 : -1;
+}
+
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+
+static void write_chunk(FILE* file, const char type[], const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    put_u32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put_u32(chunk, crc32(&chunk[4], chunk.size() - 4, 0));
+    fwrite(&chunk[0], 1, chunk.size(), file);
+}
+
+
+int write_png(const char filename[], const uint8_t* rgb, int width, int height)
+{
+    // Rows are prefixed with filter type 0 (none).
+    size_t stride = (size_t) width * 3;
+    std::vector<uint8_t> raw((stride + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw[y * (stride + 1)] = 0;
+        memcpy(&raw[y * (stride + 1) + 1], rgb + y * stride, stride);
+    }
+
+    // Wrap the rows in a zlib stream of uncompressed (stored) deflate blocks;
+    // fast to write and needs no compression library.
+    std::vector<uint8_t> idat;
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t len = std::min(raw.size() - pos, (size_t) 65535);
+        idat.push_back(pos + len == raw.size());
+        idat.push_back(len & 0xff);
+        idat.push_back(len >> 8);
+        idat.push_back(~len & 0xff);
+        idat.push_back((~len >> 8) & 0xff);
+        idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32(idat, (b << 16) | a);
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) return -1;
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+    std::vector<uint8_t> ihdr;
+    put_u32(ihdr, width);
+    put_u32(ihdr, height);
+    ihdr.push_back(8);              // Bit depth.
+    ihdr.push_back(2);              // Truecolor RGB.
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    write_chunk(file, "IHDR", ihdr);
+    write_chunk(file, "IDAT", idat);
+    write_chunk(file, "IEND", std::vector<uint8_t>());
+    return fclose(file) == 0 ? 0 : -1;
+}
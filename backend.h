@@ -0,0 +1,49 @@
+#ifndef _BACKEND_H_
+#define _BACKEND_H_
+#include <stdio.h>
+#include <stdint.h>
+#include "types.h"
+
+
+#define BACKEND_WINDOW 0            // GLFW window (unavailable when built with NO_GLFW).
+#define BACKEND_HEADLESS 1          // No display; frames optionally written to disk.
+
+#define OUTPUT_NONE 0
+#define OUTPUT_PPM 1                // One <prefix>_NNNNN.ppm per frame.
+#define OUTPUT_PNG 2                // One <prefix>_NNNNN.png per frame.
+#define OUTPUT_RAW 3                // All frames as top-down RGB into one stream.
+
+
+// Presents resolved frames, either in a window or offscreen.
+struct Backend {
+    int type;
+    int width;
+    int height;
+    void* window;                   // GLFWwindow* for BACKEND_WINDOW.
+    int output;
+    char prefix[256];
+    FILE* raw;
+    unsigned long frame;
+    unsigned long max_frames;       // Headless only; 0 runs until stopped.
+    uint8_t* scratch;               // Top-down copy of the frame for file output.
+};
+
+
+Backend* create_window_backend(int width, int height, const char title[]);
+
+Backend* create_headless_backend(int width, int height, int output, const char prefix[], unsigned long max_frames);
+
+int parse_output_format(const char name[]);
+
+bool backend_running(Backend* backend);
+
+void present_frame(Backend* backend, Camera* cam);
+
+void destroy_backend(Backend* backend);
+
+int write_ppm(const char filename[], const uint8_t* rgb, int width, int height);
+
+int write_png(const char filename[], const uint8_t* rgb, int width, int height);
+
+
+#endif
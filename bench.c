@@ -0,0 +1,382 @@
+/* Project ........ Python Game Engine
+ * Filename ....... bench.c
+ * Description .... Headless frame-time benchmark over fixed camera paths, with JSON output.
+ *                  Streaming meshes are also checked against their memory budget.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -o bench bench.c synth.c profiler.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c streaming.c assets.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "imports.h"
+#include "camera.h"
+#include "rasterization.h"
+#include "vtexture.h"
+#include "meshfile.h"
+#include "synth.h"
+#include "streaming.h"
+#include "profiler.h"
+#include "assets.h"
+
+
+// Render settings (as in main.c).
+const int FRAME_WIDTH = 640;
+const int FRAME_HEIGHT = 480;
+const float FOV = 35;
+const float MIN_DRAW_DIST = 0.01f;
+const float MAX_DRAW_DIST = 100.0f;
+
+#define BENCH_NUM_STAGES 4
+#define BENCH_DEFAULT_BUDGET_MB 64      // Chunk memory for --stream.
+
+static const char* stage_names[BENCH_NUM_STAGES] = {"clear", "camera", "rasterize", "resolve"};
+
+
+// Scene rendered along an orbit around the z-axis.
+struct BenchScene {
+    const char* name;
+    const char* mesh;
+    const char* texture;
+    float radius;
+    float height;
+};
+
+
+static const BenchScene scenes[] = {
+    {"Scene1", "models/Scene1.obj", "textures/Scene1.png", 7.07f, 5},
+    {"Scene2", "models/Scene2.obj", "textures/Scene2_baked.png", 7.07f, 5},
+};
+
+
+struct BenchResult {
+    std::string name;
+    unsigned long faces;
+    std::vector<double> frame_ms;
+    double stage_ms[BENCH_NUM_STAGES];
+    RasterStats stats;              // Totals over the measured frames (-DRASTER_STATS).
+    bool sampled;                   // Hardware counters were read (--counters).
+    uint64_t stage_counters[BENCH_NUM_STAGES][PROFILE_NUM_COUNTERS];    // Means per frame.
+    
+    // Streaming meshes only: the budget and the most memory seen in use.
+    bool streamed;
+    size_t budget;
+    size_t peak_committed;          // Resident and in-flight chunks.
+    size_t peak_resident;
+    unsigned long chunk_loads;
+    unsigned long chunk_failures;
+};
+
+
+static double percentile(std::vector<double> values, double p)
+{
+    // Nearest-rank percentile.
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t) ceil(p / 100 * values.size());
+    return values[std::min(std::max(rank, (size_t) 1), values.size()) - 1];
+}
+
+
+static double mean(const std::vector<double>& values)
+{
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); i++) sum += values[i];
+    return sum / values.size();
+}
+
+
+static BenchResult run_scene(const BenchScene* scene, std::vector<Object>& objects, int warmup, int frames, bool counters, StreamingMesh* smesh = NULL)
+{
+    Eigen::Vector3f origin(scene->radius, 0, scene->height);
+    Eigen::Vector3f direction = -origin.normalized();
+    Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, origin, direction, FOV, MIN_DRAW_DIST, MAX_DRAW_DIST);
+
+    BenchResult result;
+    result.name = scene->name;
+    result.faces = 0;
+    for (size_t o = 0; o < objects.size() && !smesh; o++) result.faces += objects[o].mesh->num_faces;
+    for (size_t c = 0; smesh && c < smesh->chunks.size(); c++) result.faces += smesh->chunks[c].info.num_faces;
+    result.streamed = smesh != NULL;
+    result.budget = smesh ? smesh->budget : 0;
+    result.peak_committed = result.peak_resident = 0;
+    memset(result.stage_ms, 0, sizeof(result.stage_ms));
+    memset(result.stage_counters, 0, sizeof(result.stage_counters));
+    result.sampled = counters;
+
+    // One full orbit over the measured frames; warmup frames retrace its start.
+    for (int k = -warmup; k < frames; k++) {
+        float theta = 2 * M_PI * (k < 0 ? k + warmup : k) / frames;
+        origin << scene->radius * cos(theta), scene->radius * sin(theta), scene->height;
+        direction = -origin.normalized();
+
+        // Counters are read just outside each timed interval.
+        std::chrono::high_resolution_clock::time_point t[BENCH_NUM_STAGES + 1];
+        uint64_t c[BENCH_NUM_STAGES + 1][PROFILE_NUM_COUNTERS];
+        if (counters) profile_read_counters(c[0]);
+        t[0] = std::chrono::high_resolution_clock::now();
+        reset_camera(&cam);
+        t[1] = std::chrono::high_resolution_clock::now();
+        if (counters) profile_read_counters(c[1]);
+        move_camera(&cam, origin, direction);
+        update_camera(&cam);
+        t[2] = std::chrono::high_resolution_clock::now();
+        if (counters) profile_read_counters(c[2]);
+        if (smesh) {
+            // Streaming meshes draw their resident chunks with the object's texture.
+            update_streaming_mesh(smesh, &cam);
+            result.peak_committed = std::max(result.peak_committed, smesh->committed);
+            result.peak_resident = std::max(result.peak_resident, streaming_resident_bytes(smesh));
+            rasterize_streaming_mesh(&cam, smesh, objects[0].texture);
+        }
+        for (size_t o = 0; o < objects.size() && !smesh; o++) {
+            use_object(&objects[o]);
+            rasterize_mesh(&cam, &objects[o]);
+            if (objects[o].texture && objects[o].texture->virt) vt_update(objects[o].texture->virt->cache);
+        }
+        update_assets();
+        t[3] = std::chrono::high_resolution_clock::now();
+        if (counters) profile_read_counters(c[3]);
+        resolve_camera(&cam);
+        t[4] = std::chrono::high_resolution_clock::now();
+        if (counters) profile_read_counters(c[4]);
+
+        if (k < 0) {
+            reset_raster_stats(&cam);
+            continue;
+        }
+        for (int s = 0; s < BENCH_NUM_STAGES; s++) {
+            result.stage_ms[s] += std::chrono::duration<double, std::milli>(t[s + 1] - t[s]).count();
+            for (int k = 0; k < PROFILE_NUM_COUNTERS && counters; k++) {
+                if (c[0][k] == PROFILE_COUNTER_UNAVAILABLE) result.stage_counters[s][k] = PROFILE_COUNTER_UNAVAILABLE;
+                else result.stage_counters[s][k] += c[s + 1][k] - c[s][k];
+            }
+        }
+        result.frame_ms.push_back(std::chrono::duration<double, std::milli>(t[BENCH_NUM_STAGES] - t[0]).count());
+    }
+    for (int s = 0; s < BENCH_NUM_STAGES; s++) {
+        result.stage_ms[s] /= frames;
+        for (int k = 0; k < PROFILE_NUM_COUNTERS; k++) {
+            if (result.stage_counters[s][k] != PROFILE_COUNTER_UNAVAILABLE) result.stage_counters[s][k] /= frames;
+        }
+    }
+    result.stats = cam.stats;
+    result.chunk_loads = smesh ? smesh->loads : 0;
+    result.chunk_failures = smesh ? smesh->failures : 0;
+
+    destroy_camera(&cam);
+    return result;
+}
+
+
+static bool parse_synth_spec(const char spec[], SynthParams* params)
+{
+    // TRIANGLES[:OVERDRAW[:INSTANCES]], e.g. 1000000:8:4.
+    *params = default_synth_params();
+    char* end;
+    params->triangles = strtoul(spec, &end, 10);
+    if (*end == ':') params->overdraw = strtof(end + 1, &end);
+    if (*end == ':') params->instances = strtoul(end + 1, &end, 10);
+    return *end == '\0' && params->triangles > 0 && params->overdraw > 0 && params->instances > 0;
+}
+
+
+static FILE* open_json_output(const char filename[])
+{
+    // "-" keeps the real stdout for the JSON and points stdout at stderr, so
+    // everything else printed (tables, loader messages) stays out of it.
+    if (strcmp(filename, "-") != 0) return fopen(filename, "w");
+    int fd = dup(STDOUT_FILENO);
+    FILE* file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (file) dup2(STDERR_FILENO, STDOUT_FILENO);
+    return file;
+}
+
+
+static void write_json(FILE* file, const std::vector<BenchResult>& results, int warmup, int frames)
+{
+    fprintf(file, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"warmup\": %d,\n  \"frames\": %d,\n  \"scenes\": [\n",
+            FRAME_WIDTH, FRAME_HEIGHT, warmup, frames);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"faces\": %lu, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"stages_ms\": {",
+                r.name.c_str(), r.faces, mean(r.frame_ms), percentile(r.frame_ms, 50), percentile(r.frame_ms, 95), percentile(r.frame_ms, 99));
+        for (int s = 0; s < BENCH_NUM_STAGES; s++) {
+            fprintf(file, "%s\"%s\": %.4f", s ? ", " : "", stage_names[s], r.stage_ms[s]);
+        }
+        fprintf(file, "}");
+        if (r.sampled) {
+            fprintf(file, ", \"counters_per_frame\": {");
+            for (int s = 0; s < BENCH_NUM_STAGES; s++) {
+                fprintf(file, "%s\"%s\": {", s ? ", " : "", stage_names[s]);
+                for (int k = 0; k < PROFILE_NUM_COUNTERS; k++) {
+                    if (r.stage_counters[s][k] == PROFILE_COUNTER_UNAVAILABLE) fprintf(file, "%s\"%s\": null", k ? ", " : "", profile_counter_name(k));
+                    else fprintf(file, "%s\"%s\": %llu", k ? ", " : "", profile_counter_name(k), (unsigned long long) r.stage_counters[s][k]);
+                }
+                fprintf(file, "}");
+            }
+            fprintf(file, "}");
+        }
+        if (r.streamed) {
+            fprintf(file, ", \"streaming\": {\"budget_bytes\": %zu, \"peak_committed_bytes\": %zu, \"peak_resident_bytes\": %zu, "
+                    "\"chunk_loads\": %lu, \"chunk_failures\": %lu}", r.budget, r.peak_committed, r.peak_resident, r.chunk_loads, r.chunk_failures);
+        }
+#ifdef RASTER_STATS
+        const RasterStats& st = r.stats;
+        fprintf(file, ", \"stats_per_frame\": {\"triangles\": %lu, \"backfacing\": %lu, \"clipped\": %lu, \"empty\": %lu, "
+                "\"pixels_tested\": %lu, \"pixels_covered\": %lu, \"pixels_occluded\": %lu, \"pixels_shaded\": %lu}",
+                st.triangles / frames, st.backfacing / frames, st.clipped / frames, st.empty / frames,
+                st.pixels_tested / frames, st.pixels_covered / frames, st.pixels_occluded / frames, st.pixels_shaded / frames);
+#endif
+        fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+    int warmup = 30;
+    int frames = 300;
+    const char* json_filename = NULL;
+    bool counters = false;
+    std::vector<const BenchScene*> selected;
+    std::vector<SynthParams> synthetic;
+    std::vector<const char*> streamed;
+    double budget_mb = BENCH_DEFAULT_BUDGET_MB;
+    double mesh_budget_mb = 0, texture_budget_mb = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_filename = argv[++i];
+        else if (strcmp(argv[i], "--counters") == 0) counters = true;
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) streamed.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budget_mb = atof(argv[++i]);
+        else if (strcmp(argv[i], "--mesh-budget") == 0 && i + 1 < argc) mesh_budget_mb = atof(argv[++i]);
+        else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) texture_budget_mb = atof(argv[++i]);
+        else if (strcmp(argv[i], "--synth") == 0 && i + 1 < argc) {
+            SynthParams params;
+            if (!parse_synth_spec(argv[++i], &params)) {
+                printf("Invalid synthetic scene %s\n", argv[i]);
+                return 1;
+            }
+            synthetic.push_back(params);
+        } else {
+            const BenchScene* scene = NULL;
+            for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++) {
+                if (strcmp(argv[i], scenes[s].name) == 0) scene = &scenes[s];
+            }
+            if (!scene) {
+                printf("usage: %s [--frames N] [--warmup N] [--json file] [--counters] [--synth TRIANGLES[:OVERDRAW[:INSTANCES]]]...\n"
+                       "       [--stream mesh.smesh]... [--budget MB] [--mesh-budget MB] [--texture-budget MB] [Scene1] [Scene2]\n", argv[0]);
+                return 1;
+            }
+            selected.push_back(scene);
+        }
+    }
+    if (selected.empty() && synthetic.empty() && streamed.empty()) {
+        for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++) selected.push_back(&scenes[s]);
+    }
+
+    // JSON sent to stdout keeps it to itself: the report and loader logs go to stderr.
+    FILE* json = NULL;
+    if (json_filename) {
+        json = open_json_output(json_filename);
+        if (!json) {
+            printf("Could not write %s\n", json_filename);
+            return 1;
+        }
+    }
+
+    // Scenes kept in the asset cache are evicted past these budgets (0 = unlimited).
+    set_asset_budget(ASSET_MESH, (size_t) (mesh_budget_mb * 1024 * 1024));
+    set_asset_budget(ASSET_TEXTURE, (size_t) (texture_budget_mb * 1024 * 1024));
+
+    // Hardware counters are optional; without them only times are reported.
+    if (counters) counters = profile_enable_counters();
+
+    // Synthetic scenes are seen from the same orbit; their footprint fits the frame.
+    std::vector<BenchResult> results;
+    std::vector<Object> acquired;
+    int over_budget = 0;
+    for (size_t i = 0; i < selected.size() + synthetic.size() + streamed.size(); i++) {
+        std::vector<Object> objects;
+        if (i >= selected.size() + synthetic.size()) {
+            // Streaming meshes are textured with a synthetic checkerboard.
+            const char* filename = streamed[i - selected.size() - synthetic.size()];
+            StreamingMesh* smesh = open_streaming_mesh(filename, (size_t) (budget_mb * 1024 * 1024));
+            if (!smesh) {
+                printf("Could not open %s\n", filename);
+                return 1;
+            }
+            BenchScene scene = {filename, NULL, NULL, 7.07f, 5};
+            Object obj;
+            obj.mesh = NULL;
+            obj.texture = synth_texture(default_synth_params().texture_size, 1);
+            objects.push_back(obj);
+            results.push_back(run_scene(&scene, objects, warmup, frames, counters, smesh));
+            close_streaming_mesh(smesh);
+            free_texture(obj.texture);
+        } else if (i < selected.size()) {
+            // Scenes stay in the asset cache until the end, so the report covers all of them.
+            objects.push_back(acquire_object(selected[i]->mesh, selected[i]->texture, MESH_OPTIMIZE_ORDER));
+            if (!objects[0].mesh || !objects[0].texture) {
+                printf("Could not load %s / %s\n", selected[i]->mesh, selected[i]->texture);
+                return 1;
+            }
+            results.push_back(run_scene(selected[i], objects, warmup, frames, counters));
+            acquired.push_back(objects[0]);
+        } else {
+            const SynthParams& params = synthetic[i - selected.size()];
+            char name[64];
+            snprintf(name, sizeof(name), "synth-%lu-x%g-i%u", params.triangles, params.overdraw, params.instances);
+            BenchScene scene = {name, NULL, NULL, 7.07f, 5};
+            objects = synth_scene(&params);
+            results.push_back(run_scene(&scene, objects, warmup, frames, counters));
+            free_synth_scene(objects);
+        }
+        const BenchResult& r = results.back();
+        printf("%-10s mean %7.3f ms  p50 %7.3f  p95 %7.3f  p99 %7.3f  (", r.name.c_str(), mean(r.frame_ms),
+               percentile(r.frame_ms, 50), percentile(r.frame_ms, 95), percentile(r.frame_ms, 99));
+        for (int s = 0; s < BENCH_NUM_STAGES; s++) printf("%s%s %.3f", s ? ", " : "", stage_names[s], r.stage_ms[s]);
+        printf(")\n");
+        for (int s = 0; s < BENCH_NUM_STAGES && r.sampled; s++) {
+            // Per-frame means; "-" where the PMU has no such counter.
+            printf("  %-10s", stage_names[s]);
+            for (int k = 0; k < PROFILE_NUM_COUNTERS; k++) {
+                if (r.stage_counters[s][k] == PROFILE_COUNTER_UNAVAILABLE) printf("  %s -", profile_counter_name(k));
+                else printf("  %s %llu", profile_counter_name(k), (unsigned long long) r.stage_counters[s][k]);
+            }
+            const uint64_t* sc = r.stage_counters[s];
+            if (sc[PROFILE_CYCLES] && sc[PROFILE_CYCLES] != PROFILE_COUNTER_UNAVAILABLE && sc[PROFILE_INSTRUCTIONS] != PROFILE_COUNTER_UNAVAILABLE) {
+                printf("  IPC %.2f", (double) sc[PROFILE_INSTRUCTIONS] / sc[PROFILE_CYCLES]);
+            }
+            printf("\n");
+        }
+#ifdef RASTER_STATS
+        print_raster_stats(stdout, &r.stats, frames);
+#endif
+        if (r.streamed) {
+            // Resident plus in-flight chunks must never exceed the budget.
+            bool ok = r.peak_committed <= r.budget;
+            printf("  streaming  %s  peak %.2f MB committed, %.2f MB resident of %.2f MB budget; %lu chunk loads, %lu failed\n",
+                   ok ? "ok" : "OVER BUDGET", r.peak_committed / 1048576.0, r.peak_resident / 1048576.0, r.budget / 1048576.0,
+                   r.chunk_loads, r.chunk_failures);
+            over_budget += !ok;
+        }
+    }
+
+    if (!acquired.empty()) print_asset_report(stdout);
+    for (size_t i = 0; i < acquired.size(); i++) release_object(&acquired[i]);
+
+    if (json) {
+        write_json(json, results, warmup, frames);
+        fclose(json);
+    }
+    return over_budget ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+/* Project ........ Python Game Engine
+ * Filename ....... bench_loader.c
+ * Description .... Measures OBJ loading throughput of load_mesh in MB/s, and checks the
+ *                  parser on small edge-case files (--check).
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -o bench_loader bench_loader.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include "imports.h"
+#include "meshfile.h"
+
+
+// Small OBJ files with the triangles the loader should make of them.
+struct LoaderCase {
+    const char* name;
+    const char* obj;
+    unsigned long faces;
+};
+
+
+static const char CUBE_CORNERS[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n";
+
+static const LoaderCase cases[] = {
+    {"triangle", "f 1/1/1 2/1/1 3/1/1\n", 1},
+    {"quad", "f 1/1/1 2/1/1 3/1/1 4/1/1\n", 2},
+    {"relative indices", "f -4/-1/-1 -3/-1/-1 -2/-1/-1\n", 1},
+    {"positions only", "f 1 2 3\nf 1//1 3//1 4//1\n", 2},
+    {"no trailing newline", "f 1/1/1 2/1/1 3/1/1", 1},
+    {"comment after face", "f 1/1/1 2/1/1 3/1/1 # note\n", 1},
+    {"non-numeric corner", "f 1/1/1 2/1/1 3/1/1 x\nf 1/1/1 3/1/1 4/1/1\n", 1},
+    {"non-numeric first corner", "f x 1/1/1 2/1/1 3/1/1\nf 1/1/1 3/1/1 4/1/1\n", 1},
+    {"zero index", "f 0/1/1 1/1/1 2/1/1\nf 1/1/1 3/1/1 4/1/1\n", 1},
+    {"bare sign", "f 1/1/1 2/1/1 - 3/1/1\nf 1/1/1 3/1/1 4/1/1\n", 1},
+};
+
+
+static int check_loader()
+{
+    // A parser that stops advancing would hang; the alarm turns that into a failure.
+    alarm(30);
+    char filename[] = "/tmp/bench_loader_XXXXXX.obj";
+    int failures = 0;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        int fd = mkstemps(filename, 4);
+        if (fd < 0) {
+            printf("Could not create a temporary file\n");
+            return 1;
+        }
+        FILE* file = fdopen(fd, "w");
+        fprintf(file, "%s%s", CUBE_CORNERS, cases[c].obj);
+        fclose(file);
+        Mesh* mesh = load_mesh(filename);
+        bool ok = mesh && mesh->num_faces == cases[c].faces;
+        printf("%-26s %s  %lu faces (expected %lu)\n", cases[c].name, ok ? "ok  " : "FAIL", mesh ? mesh->num_faces : 0, cases[c].faces);
+        failures += !ok;
+        if (mesh) free_mesh(mesh);
+        unlink(filename);
+        memcpy(filename + strlen(filename) - 10, "XXXXXX", 6);
+    }
+    printf("%d of %zu cases failed\n", failures, sizeof(cases) / sizeof(cases[0]));
+    return failures ? 1 : 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && strcmp(argv[1], "--check") == 0) return check_loader();
+    if (argc < 2) {
+        printf("usage: %s <mesh.obj> [iterations]\n"
+               "       %s --check\n", argv[0], argv[0]);
+        return 1;
+    }
+    int iterations = argc > 2 ? atoi(argv[2]) : 5;
+    struct stat st;
+    if (stat(argv[1], &st) != 0) {
+        printf("Could not open %s\n", argv[1]);
+        return 1;
+    }
+    double megabytes = st.st_size / (1024.0 * 1024.0);
+
+    // Report the best of several runs to filter out scheduling noise.
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        Mesh* mesh = load_mesh(argv[1]);
+        auto finish = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(finish - start).count();
+        if (seconds < best) best = seconds;
+
+        if (!mesh) {
+            printf("Could not load %s\n", argv[1]);
+            return 1;
+        }
+        free_mesh(mesh);
+    }
+    printf("%s: %.1f MB in %.3f s (%.1f MB/s)\n", argv[1], megabytes, best, megabytes / best);
+    return 0;
+}
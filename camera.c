@@ -4,16 +4,24 @@
  * Created by ..... Thomas Bellucci
  * Date ........... Dec 20th, 2020
  */  
-#include <GLFW/glfw3.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #include <Eigen/Dense>
 #include <iostream>
+#include <algorithm>
 #include "imports.h"
 #include "types.h"
+#include "camera.h"
+#include "profiler.h"
 
 
 
-Eigen::Matrix4f* camera_transform(Eigen::Vector3f origin, Eigen::Vector3f direction)
+Eigen::Matrix4f camera_transform(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction)
 {
     // Define orthogonal camera basis (u, v, w).
     Eigen::Vector3f t(0, 0, 1);                      // up-vector (assuming z = up)
@@ -36,13 +44,11 @@ Eigen::Matrix4f* camera_transform(Eigen::Vector3f origin, Eigen::Vector3f direct
           0, 0, 0, 1;
       
     // Transform world points into camera coordinates.
-    Eigen::Matrix4f* Mcam = new Eigen::Matrix4f(4, 4);
-    (*Mcam) = Muvw * Mo;
-    return Mcam;
+    return Muvw * Mo;
 }
 
 
-Eigen::Matrix4f* viewport_transform(unsigned int frame_width, unsigned int frame_height, float fov, float n, float f)
+Eigen::Matrix4f viewport_transform(unsigned int frame_width, unsigned int frame_height, float fov, float n, float f)
 {
     // Compute t, half the height of the frustum.
     float t = n * tan(M_PI * fov / 360);
@@ -75,62 +81,228 @@ Eigen::Matrix4f* viewport_transform(unsigned int frame_width, unsigned int frame
              0, 0, 0, 1;
              
     // Precompute viewport transform.
-    Eigen::Matrix4f* Mvp = new Eigen::Matrix4f(4, 4);
-    (*Mvp) = Mview * Morth * P;
-    return Mvp;
+    return Mview * Morth * P;
 }
 
 
 Camera create_camera(int frame_width, int frame_height, Eigen::Vector3f origin, Eigen::Vector3f direction, float fov, float min_draw_dist, float max_draw_dist)
 {
-    // Make local copy of origin and direction.
-    Eigen::Vector3f* origin_cpy = new Eigen::Vector3f;
-    (*origin_cpy) = origin;
-    Eigen::Vector3f* direction_cpy = new Eigen::Vector3f;
-    (*direction_cpy) = direction;
-    
     Camera cam;
     cam.Mvp = viewport_transform(frame_width, frame_height, fov, -min_draw_dist, -max_draw_dist);
-    cam.Mcam = camera_transform((*origin_cpy), (*direction_cpy));
-    cam.origin = origin_cpy;
-    cam.direction = direction_cpy;
+    cam.origin = origin;
+    cam.direction = direction;
+    cam.dirty = true;
     cam.frame_width = frame_width;
     cam.frame_height = frame_height;
-    cam.frame_buffer = new unsigned char[frame_width * frame_height * 3];
-    cam.depth_buffer = new double[frame_width * frame_height];
     cam.min_draw_dist = -min_draw_dist;
     cam.max_draw_dist = -max_draw_dist;
+    cam.tiles_x = (frame_width + TILE_SIZE - 1) / TILE_SIZE;
+    cam.tiles_y = (frame_height + TILE_SIZE - 1) / TILE_SIZE;
+    
+    // Tiles are 256-byte aligned blocks, so every tile row is one aligned 32-byte store.
+    size_t tile_pixels = (size_t) cam.tiles_x * cam.tiles_y * TILE_PIXELS;
+    cam.color_buffer = (uint32_t*) aligned_alloc(64, tile_pixels * sizeof(uint32_t));
+    cam.depth_buffer = (float*) aligned_alloc(64, tile_pixels * sizeof(float));
+    cam.frame_buffer = new unsigned char[frame_width * frame_height * 3];
+    cam.tile_epoch = new uint32_t[cam.tiles_x * cam.tiles_y];
+    cam.epoch = 1;
+    cam.stats = RasterStats();
+    cam.view = VIEW_SHADED;
+    cam.overdraw_buffer = NULL;
+    cam.reference = false;
+    clear_camera(&cam);
+    update_camera(&cam);
     return cam;
 }
 
 
-void move_camera(Camera* cam, Eigen::Vector3f origin, Eigen::Vector3f direction)
+void destroy_camera(Camera* cam)
 {
-    // Make local copy of origin and direction.
-    Eigen::Vector3f* origin_cpy = new Eigen::Vector3f;
-    (*origin_cpy) = origin;
-    Eigen::Vector3f* direction_cpy = new Eigen::Vector3f;
-    (*direction_cpy) = direction;
-    
-    cam->Mcam = camera_transform(origin, direction);
-    cam->origin = origin_cpy;
-    cam->direction = direction_cpy;
-    return;
+    free(cam->color_buffer);
+    free(cam->depth_buffer);
+    delete[] cam->frame_buffer;
+    delete[] cam->tile_epoch;
+    free(cam->overdraw_buffer);
+    cam->overdraw_buffer = NULL;
+    cam->color_buffer = NULL;
+    cam->frame_buffer = NULL;
+    cam->depth_buffer = NULL;
+    cam->tile_epoch = NULL;
+}
+
+
+void move_camera(Camera* cam, const Eigen::Vector3f& origin, const Eigen::Vector3f& direction)
+{
+    // Only mark the pose as changed; transforms are refreshed on the next update.
+    if (origin == cam->origin && direction == cam->direction) return;
+    cam->origin = origin;
+    cam->direction = direction;
+    cam->dirty = true;
+}
+
+
+void update_camera(Camera* cam)
+{
+    // Recompute the view and combined transforms if the pose changed.
+    if (!cam->dirty) return;
+    cam->Mcam = camera_transform(cam->origin, cam->direction);
+    cam->M = cam->Mvp * cam->Mcam;
+    cam->M_inv_T = cam->M.inverse().transpose();
+    cam->dirty = false;
 }
 
 
-Camera reset_camera(Camera cam)
+void clear_camera(Camera* cam)
 {
-    unsigned long size = cam.frame_width * cam.frame_height;
-    memset(cam.frame_buffer, 0, size * 3);
-    for (unsigned long i = 0; i < size; i++){
-        cam.depth_buffer[i] = cam.max_draw_dist;
+    // Clear everything now, bypassing the cache since the buffers are rewritten before being read.
+    size_t size = (size_t) cam->tiles_x * cam->tiles_y * TILE_PIXELS;
+    float far = cam->max_draw_dist;
+#ifdef __AVX2__
+    __m256i zero = _mm256_setzero_si256();
+    __m256 far8 = _mm256_set1_ps(far);
+    for (size_t i = 0; i < size; i += 8) {
+        _mm256_stream_si256((__m256i*) (cam->color_buffer + i), zero);
+        _mm256_stream_ps(cam->depth_buffer + i, far8);
     }
-    return cam;
+    _mm_sfence();
+#else
+    memset(cam->color_buffer, 0, size * sizeof(uint32_t));
+    std::fill(cam->depth_buffer, cam->depth_buffer + size, far);
+#endif
+    if (cam->overdraw_buffer) memset(cam->overdraw_buffer, 0, size * sizeof(uint16_t));
+    for (int t = 0; t < cam->tiles_x * cam->tiles_y; t++) cam->tile_epoch[t] = cam->epoch;
+}
+
+
+void clear_tile(Camera* cam, int tx, int ty)
+{
+    PROFILE_FINE_ZONE("clear tile");
+    // Tiles are contiguous, so this is two short fills.
+    int t = ty * cam->tiles_x + tx;
+    memset(cam->color_buffer + (size_t) t * TILE_PIXELS, 0, TILE_PIXELS * sizeof(uint32_t));
+    std::fill(cam->depth_buffer + (size_t) t * TILE_PIXELS, cam->depth_buffer + (size_t) (t + 1) * TILE_PIXELS, (float) cam->max_draw_dist);
+    if (cam->overdraw_buffer) memset(cam->overdraw_buffer + (size_t) t * TILE_PIXELS, 0, TILE_PIXELS * sizeof(uint16_t));
+    cam->tile_epoch[t] = cam->epoch;
 }
 
 
+void reset_camera(Camera* cam)
+{
+    PROFILE_ZONE("clear");
+    // Fast clear: every tile becomes stale and is cleared on first use or on resolve.
+    cam->epoch++;
+    if (cam->epoch == 0) {
+        // Stamps wrapped around; start over with a real clear.
+        cam->epoch = 1;
+        clear_camera(cam);
+    }
+}
 
 
+static void resolve_tile(Camera* cam, int tx, int ty)
+{
+    // Convert one tile from RGBA8 to the linear RGB image.
+    const uint32_t* src = cam->color_buffer + (size_t) (ty * cam->tiles_x + tx) * TILE_PIXELS;
+    int x0 = tx * TILE_SIZE;
+    int width = std::min(TILE_SIZE, cam->frame_width - x0);
+    int height = std::min(TILE_SIZE, cam->frame_height - ty * TILE_SIZE);
+    for (int r = 0; r < height; r++, src += TILE_SIZE) {
+        unsigned char* dst = cam->frame_buffer + 3 * ((size_t) (ty * TILE_SIZE + r) * cam->frame_width + x0);
+#ifdef __AVX2__
+        if (width == TILE_SIZE) {
+            // Drop the alpha bytes and store the 24 RGB bytes.
+            __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+            __m256i rgb = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_load_si256((const __m256i*) src), pack), join);
+            _mm_storeu_si128((__m128i*) dst, _mm256_castsi256_si128(rgb));
+            _mm_storel_epi64((__m128i*) (dst + 16), _mm256_extracti128_si256(rgb, 1));
+            continue;
+        }
+#endif
+        for (int x = 0; x < width; x++) {
+            dst[3 * x] = src[x];
+            dst[3 * x + 1] = src[x] >> 8;
+            dst[3 * x + 2] = src[x] >> 16;
+        }
+    }
+}
 
 
+static void resolve_overdraw_tile(Camera* cam, int tx, int ty)
+{
+    // Fragment counts from black through blue, green, yellow and red to white at 16.
+    static const unsigned char ramp[6][3] = {{0, 0, 0}, {0, 0, 255}, {0, 255, 0}, {255, 255, 0}, {255, 0, 0}, {255, 255, 255}};
+    const uint16_t* src = cam->overdraw_buffer + (size_t) (ty * cam->tiles_x + tx) * TILE_PIXELS;
+    int x0 = tx * TILE_SIZE;
+    int width = std::min(TILE_SIZE, cam->frame_width - x0);
+    int height = std::min(TILE_SIZE, cam->frame_height - ty * TILE_SIZE);
+    for (int r = 0; r < height; r++, src += TILE_SIZE) {
+        unsigned char* dst = cam->frame_buffer + 3 * ((size_t) (ty * TILE_SIZE + r) * cam->frame_width + x0);
+        for (int x = 0; x < width; x++) {
+            float level = std::min(src[x] / 16.0f, 1.0f) * 5;
+            int k = std::min((int) level, 4);
+            float w = level - k;
+            for (int c = 0; c < 3; c++) dst[3 * x + c] = ramp[k][c] + w * (ramp[k + 1][c] - ramp[k][c]);
+        }
+    }
+}
+
+
+void resolve_camera(Camera* cam)
+{
+    PROFILE_ZONE("resolve");
+    // Clear the tiles nothing was drawn to, then write out the linear image.
+    int num_tiles = cam->tiles_x * cam->tiles_y;
+    int stale = 0;
+    for (int t = 0; t < num_tiles; t++) stale += cam->tile_epoch[t] != cam->epoch;
+    if (stale == num_tiles) {
+        clear_camera(cam);
+        memset(cam->frame_buffer, 0, (size_t) cam->frame_width * cam->frame_height * 3);
+        return;
+    }
+    for (int ty = 0; ty < cam->tiles_y; ty++) {
+        for (int tx = 0; tx < cam->tiles_x; tx++) {
+            if (cam->tile_epoch[ty * cam->tiles_x + tx] != cam->epoch) clear_tile(cam, tx, ty);
+            if (cam->view == VIEW_OVERDRAW) resolve_overdraw_tile(cam, tx, ty);
+            else resolve_tile(cam, tx, ty);
+        }
+    }
+}
+
+
+bool set_camera_view(Camera* cam, int view)
+{
+#ifndef RASTER_STATS
+    // Fragments are only counted in instrumented builds.
+    if (view == VIEW_OVERDRAW) return false;
+#endif
+    if (view == VIEW_OVERDRAW && !cam->overdraw_buffer) {
+        size_t size = (size_t) cam->tiles_x * cam->tiles_y * TILE_PIXELS;
+        cam->overdraw_buffer = (uint16_t*) aligned_alloc(64, size * sizeof(uint16_t));
+        memset(cam->overdraw_buffer, 0, size * sizeof(uint16_t));
+
+        // Tiles drawn this frame have no counts yet; make them all stale.
+        reset_camera(cam);
+    }
+    cam->view = view;
+    return true;
+}
+
+
+void reset_raster_stats(Camera* cam)
+{
+    cam->stats = RasterStats();
+}
+
+
+void print_raster_stats(FILE* file, const RasterStats* stats, unsigned long frames)
+{
+    // Per-frame averages, with pixel counts relative to those tested.
+    frames = std::max(frames, 1ul);
+    double tested = std::max(stats->pixels_tested, 1ul);
+    fprintf(file, "triangles %lu/frame: %lu backfacing, %lu clipped, %lu empty\n", stats->triangles / frames,
+            stats->backfacing / frames, stats->clipped / frames, stats->empty / frames);
+    fprintf(file, "pixels %lu/frame tested: %.1f%% covered, %.1f%% occluded, %.1f%% shaded\n", stats->pixels_tested / frames,
+            100 * stats->pixels_covered / tested, 100 * stats->pixels_occluded / tested, 100 * stats->pixels_shaded / tested);
+}
@@ -2,17 +2,38 @@
 #define _CAMERA_TRANSFORMS_H_
 #include <Eigen/Dense>
 #include <iostream>
+#include <stdio.h>
 
 
-Eigen::Matrix4f* camera_transform(Eigen::Vector3f origin, Eigen::Vector3f direction);
+#define VIEW_SHADED 0               // Shaded colors.
+#define VIEW_OVERDRAW 1             // Heatmap of fragments per pixel; needs -DRASTER_STATS.
 
-Eigen::Matrix4f* viewport_transform(unsigned int frame_width, unsigned int frame_height, float fov, float n, float f);
+
+Eigen::Matrix4f camera_transform(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction);
+
+Eigen::Matrix4f viewport_transform(unsigned int frame_width, unsigned int frame_height, float fov, float n, float f);
 
 Camera create_camera(int frame_width, int frame_height, Eigen::Vector3f origin, Eigen::Vector3f direction, float fov, float min_draw_dist, float max_draw_dist);
 
-void move_camera(Camera* cam, Eigen::Vector3f origin, Eigen::Vector3f direction);
+void destroy_camera(Camera* cam);
+
+void move_camera(Camera* cam, const Eigen::Vector3f& origin, const Eigen::Vector3f& direction);
+
+void update_camera(Camera* cam);
+
+void clear_camera(Camera* cam);
+
+void clear_tile(Camera* cam, int tx, int ty);
+
+void reset_camera(Camera* cam);
+
+void resolve_camera(Camera* cam);
+
+bool set_camera_view(Camera* cam, int view);
+
+void reset_raster_stats(Camera* cam);
 
-Camera reset_camera(Camera cam);
+void print_raster_stats(FILE* file, const RasterStats* stats, unsigned long frames);
 
 
 
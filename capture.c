@@ -0,0 +1,185 @@
+/* Project ........ Python Game Engine
+ * Filename ....... capture.c
+ * Description .... Recording and loading of frame captures for deterministic replay.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "capture.h"
+
+
+static void write_record(FILE* file, uint32_t type, const std::vector<uint8_t>& payload)
+{
+    uint32_t record[2] = {type, (uint32_t) payload.size()};
+    fwrite(record, sizeof(record), 1, file);
+    if (!payload.empty()) fwrite(&payload[0], 1, payload.size(), file);
+}
+
+
+static void put_bytes(std::vector<uint8_t>& out, const void* data, size_t size)
+{
+    out.insert(out.end(), (const uint8_t*) data, (const uint8_t*) data + size);
+}
+
+
+static void put_string(std::vector<uint8_t>& out, const std::string& s)
+{
+    uint32_t size = s.size();
+    put_bytes(out, &size, sizeof(size));
+    put_bytes(out, s.data(), size);
+}
+
+
+CaptureWriter* begin_capture(const char filename[], int width, int height, float fov, float min_draw_dist, float max_draw_dist)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file) return NULL;
+    CaptureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header.version = CAPTURE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.fov = fov;
+    header.min_draw_dist = min_draw_dist;
+    header.max_draw_dist = max_draw_dist;
+    fwrite(&header, sizeof(header), 1, file);
+
+    CaptureWriter* writer = new CaptureWriter();
+    writer->file = file;
+    return writer;
+}
+
+
+unsigned int capture_asset(CaptureWriter* writer, const char mesh[], const char texture[], unsigned int mesh_flags)
+{
+    // Assets are recorded once; later references reuse the index.
+    for (size_t a = 0; a < writer->assets.size(); a++) {
+        const CaptureAsset& asset = writer->assets[a];
+        if (asset.mesh == mesh && asset.texture == texture && asset.flags == mesh_flags) return a;
+    }
+    CaptureAsset asset = {mesh, texture, mesh_flags};
+    writer->assets.push_back(asset);
+
+    std::vector<uint8_t> payload;
+    put_bytes(payload, &asset.flags, sizeof(asset.flags));
+    put_string(payload, asset.mesh);
+    put_string(payload, asset.texture);
+    write_record(writer->file, CAPTURE_ASSET, payload);
+    return writer->assets.size() - 1;
+}
+
+
+void capture_frame(CaptureWriter* writer, const Camera* cam)
+{
+    // The pose as last given to move_camera, which is all update_camera derives from.
+    // Earlier frames are complete by now, so they are pushed to the file.
+    fflush(writer->file);
+    std::vector<uint8_t> payload;
+    put_bytes(payload, cam->origin.data(), 3 * sizeof(float));
+    put_bytes(payload, cam->direction.data(), 3 * sizeof(float));
+    write_record(writer->file, CAPTURE_FRAME, payload);
+}
+
+
+void capture_draw(CaptureWriter* writer, unsigned int asset, const Object* obj)
+{
+    std::vector<uint8_t> payload;
+    uint32_t index = asset;
+    put_bytes(payload, &index, sizeof(index));
+    put_bytes(payload, obj->transform.data(), 16 * sizeof(float));
+    write_record(writer->file, CAPTURE_DRAW, payload);
+}
+
+
+int end_capture(CaptureWriter* writer)
+{
+    int status = fclose(writer->file) == 0 ? 0 : -1;
+    delete writer;
+    return status;
+}
+
+
+static bool get_bytes(const std::vector<uint8_t>& in, size_t* pos, void* data, size_t size)
+{
+    if (*pos + size > in.size()) return false;
+    memcpy(data, &in[*pos], size);
+    *pos += size;
+    return true;
+}
+
+
+static bool get_string(const std::vector<uint8_t>& in, size_t* pos, std::string* s)
+{
+    uint32_t size;
+    if (!get_bytes(in, pos, &size, sizeof(size)) || *pos + size > in.size()) return false;
+    s->assign((const char*) &in[*pos], size);
+    *pos += size;
+    return true;
+}
+
+
+Capture* load_capture(const char filename[])
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        printf("Could not open %s\n", filename);
+        return NULL;
+    }
+    Capture* capture = new Capture();
+    if (fread(&capture->header, sizeof(capture->header), 1, file) != 1 ||
+        memcmp(capture->header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        capture->header.version != CAPTURE_VERSION) {
+        printf("%s is not a version %d frame capture\n", filename, CAPTURE_VERSION);
+        fclose(file);
+        delete capture;
+        return NULL;
+    }
+
+    // Read records up to the end or the first incomplete or invalid one.
+    uint32_t record[2];
+    std::vector<uint8_t> payload;
+    bool valid = true;
+    while (valid && fread(record, sizeof(record), 1, file) == 1) {
+        payload.resize(record[1]);
+        if (record[1] && fread(&payload[0], 1, record[1], file) != record[1]) {
+            valid = false;
+            break;
+        }
+        size_t pos = 0;
+        if (record[0] == CAPTURE_ASSET) {
+            CaptureAsset asset;
+            valid = get_bytes(payload, &pos, &asset.flags, sizeof(asset.flags)) &&
+                    get_string(payload, &pos, &asset.mesh) && get_string(payload, &pos, &asset.texture);
+            if (valid) capture->assets.push_back(asset);
+        } else if (record[0] == CAPTURE_FRAME) {
+            CaptureFrame frame;
+            valid = get_bytes(payload, &pos, frame.origin.data(), 3 * sizeof(float)) &&
+                    get_bytes(payload, &pos, frame.direction.data(), 3 * sizeof(float));
+            if (valid) capture->frames.push_back(frame);
+        } else if (record[0] == CAPTURE_DRAW) {
+            CaptureDraw draw;
+            valid = !capture->frames.empty() && get_bytes(payload, &pos, &draw.asset, sizeof(draw.asset)) &&
+                    draw.asset < capture->assets.size() && get_bytes(payload, &pos, draw.transform.data(), 16 * sizeof(float));
+            if (valid) capture->frames.back().draws.push_back(draw);
+        }
+        // Unknown record types are skipped, so newer writers stay readable.
+    }
+    if (!valid) {
+        // The last frame may be missing draws.
+        if (!capture->frames.empty()) capture->frames.pop_back();
+        printf("%s is truncated or corrupt; keeping %zu complete frames\n", filename, capture->frames.size());
+    }
+    fclose(file);
+    return capture;
+}
+
+
+void free_capture(Capture* capture)
+{
+    delete capture;
+}
@@ -0,0 +1,84 @@
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "types.h"
+
+
+#define CAPTURE_MAGIC "FRMCAP1"
+#define CAPTURE_VERSION 1
+#define CAPTURE_EXTENSION ".fcap"
+
+// Record types following the header.
+#define CAPTURE_ASSET 1             // Mesh and texture paths with mesh load flags.
+#define CAPTURE_FRAME 2             // Camera origin and direction as passed to move_camera.
+#define CAPTURE_DRAW 3              // Asset index and object transform, within the last frame.
+
+
+// Header of a frame capture (.fcap). Records follow as {type, size, payload}
+// and are appended as frames are rendered, so a capture cut short by a crash
+// still replays up to its last complete record.
+struct CaptureHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    float fov;
+    float min_draw_dist;
+    float max_draw_dist;
+};
+
+
+struct CaptureAsset {
+    std::string mesh;
+    std::string texture;
+    uint32_t flags;
+};
+
+
+struct CaptureDraw {
+    uint32_t asset;
+    Eigen::Matrix4f transform;
+};
+
+
+struct CaptureFrame {
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;
+    std::vector<CaptureDraw> draws;
+};
+
+
+struct Capture {
+    CaptureHeader header;
+    std::vector<CaptureAsset> assets;
+    std::vector<CaptureFrame> frames;
+};
+
+
+// Appends records to an open capture file.
+struct CaptureWriter {
+    FILE* file;
+    std::vector<CaptureAsset> assets;
+};
+
+
+CaptureWriter* begin_capture(const char filename[], int width, int height, float fov, float min_draw_dist, float max_draw_dist);
+
+unsigned int capture_asset(CaptureWriter* writer, const char mesh[], const char texture[], unsigned int mesh_flags);
+
+void capture_frame(CaptureWriter* writer, const Camera* cam);
+
+void capture_draw(CaptureWriter* writer, unsigned int asset, const Object* obj);
+
+int end_capture(CaptureWriter* writer);
+
+Capture* load_capture(const char filename[]);
+
+void free_capture(Capture* capture);
+
+
+#endif
@@ -0,0 +1,228 @@
+/* Project ........ Python Game Engine
+ * Filename ....... golden.c
+ * Description .... Golden-image checks: fixed views against reference images, and the
+ *                  optimized render paths against the scalar reference paths.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -DNO_GLFW -o golden golden.c imagediff.c synth.c backend.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "imports.h"
+#include "camera.h"
+#include "rasterization.h"
+#include "vtexture.h"
+#include "meshfile.h"
+#include "backend.h"
+#include "synth.h"
+#include "imagediff.h"
+
+
+// Render settings (as in main.c).
+const int FRAME_WIDTH = 640;
+const int FRAME_HEIGHT = 480;
+const float FOV = 35;
+const float MIN_DRAW_DIST = 0.01f;
+const float MAX_DRAW_DIST = 100.0f;
+
+
+// Fixed camera on an orbit around the z-axis. Views without a mesh render a
+// synthetic grid of instances, which exercises object transforms and overdraw.
+struct GoldenView {
+    const char* name;
+    const char* mesh;
+    const char* texture;
+    unsigned int flags;
+    float angle;
+    float radius;
+    float height;
+};
+
+
+static const GoldenView views[] = {
+    {"scene1_front", "models/Scene1.obj", "textures/Scene1.png", MESH_OPTIMIZE_ORDER, 0.0f, 7.07f, 5},
+    {"scene1_back", "models/Scene1.obj", "textures/Scene1.png", MESH_OPTIMIZE_ORDER, 2.5f, 7.07f, 5},
+    {"scene2_front", "models/Scene2.obj", "textures/Scene2_baked.png", MESH_OPTIMIZE_ORDER, 0.0f, 7.07f, 5},
+    {"scene2_side", "models/Scene2.obj", "textures/Scene2_baked.png", MESH_OPTIMIZE_ORDER, 2.1f, 7.07f, 5},
+    {"scene2_low", "models/Scene2.obj", "textures/Scene2_baked.png", MESH_OPTIMIZE_ORDER, 4.2f, 9.0f, 1.5f},
+    {"scene2_quantized", "models/Scene2.obj", "textures/Scene2_baked.png", MESH_OPTIMIZE_ORDER | MESH_QUANTIZE, 0.7f, 7.07f, 5},
+    {"synth_grid", NULL, NULL, 0, 0.4f, 12.0f, 9},
+};
+
+
+static std::vector<Object> load_view(const GoldenView* view)
+{
+    if (view->mesh) return std::vector<Object>(1, load_object(view->mesh, view->texture, view->flags));
+    SynthParams params = default_synth_params();
+    params.triangles = 40000;
+    params.instances = 4;
+    params.layout = SYNTH_LAYOUT_GRID;
+    return synth_scene(&params);
+}
+
+
+static void free_view(const GoldenView* view, std::vector<Object>& objects)
+{
+    if (!view->mesh) {
+        free_synth_scene(objects);
+        return;
+    }
+    free_mesh(objects[0].mesh);
+    free_texture(objects[0].texture);
+}
+
+
+static std::vector<uint8_t> render_view(const GoldenView* view, std::vector<Object>& objects, bool reference)
+{
+    Eigen::Vector3f origin(view->radius * cosf(view->angle), view->radius * sinf(view->angle), view->height);
+    Eigen::Vector3f direction = -origin.normalized();
+    Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, origin, direction, FOV, MIN_DRAW_DIST, MAX_DRAW_DIST);
+    cam.reference = reference;
+
+    // Two frames, so lazily cleared tiles are exercised as well.
+    for (int frame = 0; frame < 2; frame++) {
+        reset_camera(&cam);
+        for (size_t o = 0; o < objects.size(); o++) {
+            rasterize_mesh(&cam, &objects[o]);
+            if (objects[o].texture && objects[o].texture->virt) vt_update(objects[o].texture->virt->cache);
+        }
+        resolve_camera(&cam);
+    }
+
+    // Top-down, as image files are.
+    size_t stride = (size_t) FRAME_WIDTH * 3;
+    std::vector<uint8_t> rgb(stride * FRAME_HEIGHT);
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        memcpy(&rgb[y * stride], cam.frame_buffer + (FRAME_HEIGHT - 1 - y) * stride, stride);
+    }
+    destroy_camera(&cam);
+    return rgb;
+}
+
+
+static bool check(const char name[], const uint8_t* expected, const uint8_t* actual, int tolerance, unsigned long budget, const std::string& diff_filename)
+{
+    std::vector<uint8_t> diff_rgb((size_t) FRAME_WIDTH * FRAME_HEIGHT * 3);
+    ImageDiff diff = diff_images(expected, actual, FRAME_WIDTH, FRAME_HEIGHT, tolerance, &diff_rgb[0]);
+    bool ok = images_match(&diff, budget);
+    printf("%-20s %s  %lu changed, %lu beyond tolerance (budget %lu), max delta %d\n", name, ok ? "ok  " : "FAIL",
+           diff.changed, diff.differing, budget, diff.max_delta);
+    if (!ok) {
+        write_png(diff_filename.c_str(), &diff_rgb[0], FRAME_WIDTH, FRAME_HEIGHT);
+        printf("%-20s wrote %s\n", "", diff_filename.c_str());
+    }
+    return ok;
+}
+
+
+static int compare_files(const char expected_filename[], const char actual_filename[], int tolerance, unsigned long budget, const char diff_filename[])
+{
+    int w0, h0, w1, h1;
+    uint8_t* expected = load_image(expected_filename, &w0, &h0);
+    uint8_t* actual = load_image(actual_filename, &w1, &h1);
+    int status = 1;
+    if (!expected || !actual) {
+        printf("Could not read %s\n", !expected ? expected_filename : actual_filename);
+    } else if (w0 != w1 || h0 != h1) {
+        printf("Sizes differ: %dx%d and %dx%d\n", w0, h0, w1, h1);
+    } else {
+        std::vector<uint8_t> diff_rgb((size_t) w0 * h0 * 3);
+        ImageDiff diff = diff_images(expected, actual, w0, h0, tolerance, &diff_rgb[0]);
+        bool ok = images_match(&diff, budget);
+        printf("%s  %lu of %lu pixels changed, %lu beyond tolerance (budget %lu), max delta %d, mean %.4f\n",
+               ok ? "ok" : "FAIL", diff.changed, diff.pixels, diff.differing, budget, diff.max_delta, diff.mean_delta);
+        if (!ok && diff_filename) write_png(diff_filename, &diff_rgb[0], w0, h0);
+        status = ok ? 0 : 1;
+    }
+    if (expected) free_image(expected);
+    if (actual) free_image(actual);
+    return status;
+}
+
+
+int main(int argc, char* argv[])
+{
+    // Modes: check against references (default), --update them, check the optimized
+    // paths against the --reference paths, or --compare two image files.
+    const char* dir = "golden";
+    bool update = false;
+    bool reference = false;
+    int tolerance = 0;
+    unsigned long budget = 0;
+    std::vector<const char*> files;
+    std::vector<const GoldenView*> selected;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--update") == 0) update = true;
+        else if (strcmp(argv[i], "--reference") == 0) reference = true;
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budget = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc) {
+            files.push_back(argv[++i]);
+            files.push_back(argv[++i]);
+            if (i + 1 < argc && argv[i + 1][0] != '-') files.push_back(argv[++i]);
+        } else {
+            const GoldenView* view = NULL;
+            for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); v++) {
+                if (strcmp(argv[i], views[v].name) == 0) view = &views[v];
+            }
+            if (!view) {
+                printf("usage: %s [--dir path] [--update | --reference] [--tolerance T] [--budget N] [view]...\n"
+                       "       %s --compare expected actual [diff.png] [--tolerance T] [--budget N]\n", argv[0], argv[0]);
+                return 1;
+            }
+            selected.push_back(view);
+        }
+    }
+    if (!files.empty()) return compare_files(files[0], files[1], tolerance, budget, files.size() > 2 ? files[2] : NULL);
+    if (selected.empty()) {
+        for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); v++) selected.push_back(&views[v]);
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < selected.size(); i++) {
+        const GoldenView* view = selected[i];
+        std::vector<Object> objects = load_view(view);
+        if (view->mesh && (!objects[0].mesh || !objects[0].texture)) {
+            printf("%-20s FAIL  could not load %s / %s\n", view->name, view->mesh, view->texture);
+            if (objects[0].mesh) free_mesh(objects[0].mesh);
+            free_texture(objects[0].texture);
+            failures++;
+            continue;
+        }
+        std::vector<uint8_t> actual = render_view(view, objects, false);
+        std::string base = std::string(dir) + "/" + view->name;
+
+        if (update) {
+            // New references; review them before checking them in.
+            if (write_png((base + ".png").c_str(), &actual[0], FRAME_WIDTH, FRAME_HEIGHT) != 0) {
+                printf("Could not write %s.png\n", base.c_str());
+                failures++;
+            } else {
+                printf("%-20s wrote %s.png\n", view->name, base.c_str());
+            }
+        } else if (reference) {
+            std::vector<uint8_t> expected = render_view(view, objects, true);
+            failures += !check(view->name, &expected[0], &actual[0], tolerance, budget, base + "_reference_diff.png");
+        } else {
+            int width, height;
+            uint8_t* expected = load_image((base + ".png").c_str(), &width, &height);
+            if (!expected || width != FRAME_WIDTH || height != FRAME_HEIGHT) {
+                printf("%-20s FAIL  no %dx%d reference %s.png (create with --update)\n", view->name, FRAME_WIDTH, FRAME_HEIGHT, base.c_str());
+                failures++;
+            } else {
+                bool ok = check(view->name, expected, &actual[0], tolerance, budget, base + "_diff.png");
+                if (!ok) write_png((base + "_actual.png").c_str(), &actual[0], FRAME_WIDTH, FRAME_HEIGHT);
+                failures += !ok;
+            }
+            if (expected) free_image(expected);
+        }
+        free_view(view, objects);
+    }
+    printf("%d of %zu views failed\n", failures, selected.size());
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+/* Project ........ Python Game Engine
+ * Filename ....... imagediff.c
+ * Description .... Tolerance-aware comparison of rendered images.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdlib.h>
+#include <algorithm>
+#include "imagediff.h"
+#include "stb_image.h"
+
+
+uint8_t* load_image(const char filename[], int* width, int* height)
+{
+    // PNG and PPM (among others) as top-down RGB.
+    int bpp;
+    return stbi_load(filename, width, height, &bpp, 3);
+}
+
+
+void free_image(uint8_t* rgb)
+{
+    stbi_image_free(rgb);
+}
+
+
+ImageDiff diff_images(const uint8_t* expected, const uint8_t* actual, int width, int height, int tolerance, uint8_t* diff_rgb)
+{
+    ImageDiff diff = ImageDiff();
+    diff.pixels = (unsigned long) width * height;
+    double total = 0;
+    for (unsigned long p = 0; p < diff.pixels; p++) {
+        const uint8_t* a = expected + 3 * p;
+        const uint8_t* b = actual + 3 * p;
+        int delta = std::max(abs(a[0] - b[0]), std::max(abs(a[1] - b[1]), abs(a[2] - b[2])));
+        diff.max_delta = std::max(diff.max_delta, delta);
+        diff.changed += delta > 0;
+        diff.differing += delta > tolerance;
+        total += delta;
+
+        // The diff image shows the expected image dimmed to grey, pixels within
+        // tolerance in yellow and those beyond it in red.
+        if (diff_rgb) {
+            uint8_t* d = diff_rgb + 3 * p;
+            uint8_t grey = (a[0] + a[1] + a[2]) / 12;
+            d[0] = delta ? 255 : grey;
+            d[1] = delta && delta <= tolerance ? 255 : grey;
+            d[2] = delta ? 0 : grey;
+        }
+    }
+    diff.mean_delta = diff.pixels ? total / diff.pixels : 0;
+    return diff;
+}
+
+
+bool images_match(const ImageDiff* diff, unsigned long budget)
+{
+    return diff->differing <= budget;
+}
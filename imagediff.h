@@ -0,0 +1,25 @@
+#ifndef _IMAGEDIFF_H_
+#define _IMAGEDIFF_H_
+#include <stdint.h>
+
+
+// Result of comparing two RGB images of the same size.
+struct ImageDiff {
+    unsigned long pixels;
+    unsigned long differing;        // Pixels with a channel off by more than the tolerance.
+    unsigned long changed;          // Pixels that differ at all.
+    int max_delta;                  // Largest channel difference.
+    double mean_delta;              // Mean of the largest channel difference per pixel.
+};
+
+
+uint8_t* load_image(const char filename[], int* width, int* height);
+
+void free_image(uint8_t* rgb);
+
+ImageDiff diff_images(const uint8_t* expected, const uint8_t* actual, int width, int height, int tolerance, uint8_t* diff_rgb);
+
+bool images_match(const ImageDiff* diff, unsigned long budget);
+
+
+#endif
@@ -13,170 +13,519 @@
 #include <stdlib.h>
 #include <vector> 
 #include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include "types.h"
+#include "imports.h"
+#include "vtexture.h"
+#include "meshfile.h"
+#include "vcache.h"
+#include "quantize.h"
+#include "profiler.h"
+#include "jobs.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 
-int count_vertices(const char *string)
+// Smallest OBJ chunk worth handing to a separate thread.
+#define OBJ_MIN_CHUNK_SIZE (1 << 20)
+
+
+// Exact powers of ten for the fast path of parse_float.
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+static inline const char* skip_spaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+
+static inline const char* skip_line(const char* p, const char* end)
+{
+    const char* nl = (const char*) memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+
+static const char* parse_float(const char* p, const char* end, float* out)
+{
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+    // Accumulate up to 19 significant digits into an integer mantissa.
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += mantissa > 0; }
+        else exponent++;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += mantissa > 0; exponent--; }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) exp_negative = (*q++ == '-');
+        int e = 0;
+        if (q < end && *q >= '0' && *q <= '9') {
+            while (q < end && *q >= '0' && *q <= '9') e = std::min(e * 10 + (*q++ - '0'), 9999);
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    // Exact when mantissa and power of ten are both representable; else defer to strtod.
+    double value;
+    if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        value = exponent < 0 ? mantissa / powers_of_ten[-exponent] : mantissa * powers_of_ten[exponent];
+    } else {
+        char buffer[64];
+        size_t len = std::min((size_t) (p - start), sizeof(buffer) - 1);
+        memcpy(buffer, start, len);
+        buffer[len] = 0;
+        *out = (float) strtod(buffer, NULL);
+        return p;
+    }
+    *out = (float) (negative ? -value : value);
+    return p;
+}
+
+
+static const char* parse_int(const char* p, const char* end, long* out)
 {
-    int size = strlen(string);
-    // Count spaces.
-    int count = 0;
-    for (int i = 0; i < size; i++) {
-        int ch = (int) (string[i]);
-        if (ch == 32) count++;
-    }
-    return count;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+    long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    *out = negative ? -value : value;
+    return p;
 }
 
 
-Mesh* load_mesh(const char filename[])
+// Marks a face corner without a texture coordinate or normal.
+#define OBJ_NO_INDEX 0xffffffffu
+
+
+// Converts a 1-based (or negative, relative) OBJ index into a 0-based one.
+static inline unsigned int resolve_index(long index, unsigned long count)
 {
-    // Compute number of vertices, normals and texture coordinates in mesh.
-    unsigned long num_verts, num_texcoords, num_normals, num_faces;
-    num_verts = num_normals = num_texcoords = num_faces = 0;
-    
-    char line[512];
-    FILE *file = fopen(filename, "r");
-    while(fgets(line, 512, file)) {
-        if (strncmp(line, "v ", 2) == 0) num_verts++;
-        if (strncmp(line, "vt ", 2) == 0) num_texcoords++;
-        if (strncmp(line, "vn ", 2) == 0) num_normals++;
-        if (strncmp(line, "f ", 2) == 0) num_faces += count_vertices(line) - 2;
-    }
-    fclose(file);
-    
-    printf("Loading %ld vertices...\n", num_verts);
-    printf("Loading %ld triangle faces...\n", num_faces);
-
-    // Define buffers to store geometry (in homogeneous coordinates).
-    Eigen::MatrixXf* vertices = new Eigen::MatrixXf(4, num_verts);
-    Eigen::MatrixXf* normals = new Eigen::MatrixXf(4, num_normals);
-    Eigen::MatrixXf* texcoords = new Eigen::MatrixXf(2, num_texcoords);
-    std::vector<Tri>* faces = new std::vector<Tri>;
-    
-    // Init temporary indices for data.
-    int v0, v1, v2, v3, vt0, vt1, vt2, vt3, vn0, vn1, vn2, vn3;
-    unsigned long i_v, i_vn, i_vt;
-    i_v = i_vn = i_vt = 0;
-    double x, y, z, u, v;
-
-    // Loop through lines in file.
-    file = fopen(filename, "r");
-    while(fgets(line, 512, file)) {
+    return index > 0 ? index - 1 : (index < 0 ? count + index : OBJ_NO_INDEX);
+}
+
+
+// Triangle as separate v/vt/vn indices, as written in the OBJ file.
+struct ObjTri {
+    unsigned int iv0;
+    unsigned int iv1;
+    unsigned int iv2;
+    
+    unsigned int ivt0;
+    unsigned int ivt1;
+    unsigned int ivt2;
+    
+    unsigned int ivn0;
+    unsigned int ivn1;
+    unsigned int ivn2;
+};
+
+
+// Unique (v, vt, vn) combination, which becomes one vertex of the mesh.
+struct ObjCorner {
+    unsigned int iv;
+    unsigned int ivt;
+    unsigned int ivn;
+};
+
+
+// All geometry of an OBJ file, still indexed per attribute.
+struct ObjData {
+    std::vector<float> v, vt, vn;
+    std::vector<ObjTri> faces;
+};
+
 
+// Geometry parsed from one newline-aligned chunk of an OBJ file.
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    std::vector<float> v, vt, vn;
+    std::vector<ObjTri> faces;
+    
+    // Faces with relative indices, which still need the chunk's global base added.
+    // Bits 0-2 flag iv0..iv2, bits 3-5 ivt0..ivt2 and bits 6-8 ivn0..ivn2.
+    std::vector<std::pair<unsigned long, uint16_t> > fixups;
+    
+    unsigned long malformed;        // Face lines skipped for a missing or invalid index.
+    unsigned long base_v, base_vt, base_vn, base_f;
+};
+
+
+static void parse_obj_chunk(ObjChunk* chunk)
+{
+    PROFILE_ZONE("parse obj");
+    const char* p = chunk->begin;
+    const char* end = chunk->end;
+    
+    // Preallocate buffers from a rough bytes-per-record estimate.
+    size_t size = end - p;
+    std::vector<float>& v = chunk->v;
+    std::vector<float>& vt = chunk->vt;
+    std::vector<float>& vn = chunk->vn;
+    std::vector<ObjTri>& faces = chunk->faces;
+    v.reserve(4 * (size / 96));
+    vt.reserve(2 * (size / 96));
+    vn.reserve(4 * (size / 96));
+    faces.reserve(size / 64);
+    
+    // Corner indices of the face being parsed (v, vt, vn per corner).
+    std::vector<unsigned int> corners;
+    std::vector<uint8_t> relative;
+    chunk->malformed = 0;
+    
+    while (p < end) {
+        p = skip_spaces(p, end);
+        if (p + 1 >= end) break;
+        
         // Vertex coordinates.
-        if (strncmp(line, "v ", 2) == 0) {
-            sscanf(line, "v %lf %lf %lf", &x, &y, &z);
-            (*vertices)(0, i_v) = x;
-            (*vertices)(1, i_v) = y;
-            (*vertices)(2, i_v) = z;
-            (*vertices)(3, i_v) = 1;
-            i_v++;
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            float x = 0, y = 0, z = 0;
+            p = parse_float(skip_spaces(p + 2, end), end, &x);
+            p = parse_float(skip_spaces(p, end), end, &y);
+            p = parse_float(skip_spaces(p, end), end, &z);
+            v.push_back(x);
+            v.push_back(y);
+            v.push_back(z);
+            v.push_back(1);
         }
         
         // Texture coordinates.
-        else if (strncmp(line, "vt ", 3) == 0) {
-            sscanf(line, "vt %lf %lf", &u, &v);
-            (*texcoords)(0, i_vt) = u;
-            (*texcoords)(1, i_vt) = v;
-            i_vt++;
+        else if (p[0] == 'v' && p[1] == 't' && p + 2 < end && (p[2] == ' ' || p[2] == '\t')) {
+            float u = 0, w = 0;
+            p = parse_float(skip_spaces(p + 3, end), end, &u);
+            p = parse_float(skip_spaces(p, end), end, &w);
+            vt.push_back(u);
+            vt.push_back(w);
         }
         
         // Normals.
-        else if (strncmp(line, "vn ", 3) == 0) {
-            sscanf(line, "vn %lf %lf %lf", &x, &y, &z);
-            (*normals)(0, i_vn) = x;
-            (*normals)(1, i_vn) = y;
-            (*normals)(2, i_vn) = z;
-            (*normals)(3, i_vn) = 0;
-            i_vn++;
+        else if (p[0] == 'v' && p[1] == 'n' && p + 2 < end && (p[2] == ' ' || p[2] == '\t')) {
+            float x = 0, y = 0, z = 0;
+            p = parse_float(skip_spaces(p + 3, end), end, &x);
+            p = parse_float(skip_spaces(p, end), end, &y);
+            p = parse_float(skip_spaces(p, end), end, &z);
+            vn.push_back(x);
+            vn.push_back(y);
+            vn.push_back(z);
+            vn.push_back(0);
         }
         
-        // Faces (defined as v/vt/vn triples).
-        else if (strncmp(line, "f ", 2) == 0) {
-        
-            // Parse triangles.
-            if (count_vertices(line) == 3) {
-                sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d", &v0, &vt0, &vn0, &v1, &vt1, &vn1, &v2, &vt2, &vn2);
-                
-                Tri tri;
-                tri.iv0 = v0 - 1;
-                tri.iv1 = v1 - 1;
-                tri.iv2 = v2 - 1;
-                
-                tri.ivt0 = vt0 - 1;
-                tri.ivt1 = vt1 - 1;
-                tri.ivt2 = vt2 - 1;
+        // Faces (defined as v/vt/vn triples, triangulated as a fan).
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            corners.clear();
+            relative.clear();
+            p = skip_spaces(p + 2, end);
+            bool valid = true;
+            while (p < end && *p != '\n' && *p != '#') {
+                long iv = 0, ivt = 0, ivn = 0;
+                p = parse_int(p, end, &iv);
                 
-                tri.ivn0 = vn0 - 1;
-                tri.ivn1 = vn1 - 1;
-                tri.ivn2 = vn2 - 1;
-                faces->push_back(tri);
-            } 
-            // Parse quad as two triangles.
-            else {
-                sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d", &v0, &vt0, &vn0, &v1, &vt1, &vn1, &v2, &vt2, &vn2, &v3, &vt3, &vn3);
-
-                Tri tri1;
-                tri1.iv0 = v0 - 1;
-                tri1.iv1 = v1 - 1;
-                tri1.iv2 = v2 - 1;
+                // Every corner starts with a nonzero position index. A token that is
+                // not a number leaves p where it was, so the line is rejected here.
+                if (iv == 0) {
+                    valid = false;
+                    break;
+                }
+                if (p < end && *p == '/') {
+                    if (++p < end && *p != '/') p = parse_int(p, end, &ivt);
+                    if (p < end && *p == '/') p = parse_int(p + 1, end, &ivn);
+                }
+                corners.push_back(resolve_index(iv, v.size() / 4));
+                corners.push_back(resolve_index(ivt, vt.size() / 2));
+                corners.push_back(resolve_index(ivn, vn.size() / 4));
+                relative.push_back((iv < 0) | (ivt < 0) << 1 | (ivn < 0) << 2);
+                p = skip_spaces(p, end);
+            }
+            
+            if (!valid) {
+                chunk->malformed++;
+                corners.clear();
+            }
+            
+            // Corner k >= 2 forms (k-1, 0, k), which keeps the original quad split.
+            unsigned int num_corners = corners.size() / 3;
+            for (unsigned int k = 2; k < num_corners; k++) {
+                unsigned int a = k == 2 ? 0 : k - 1;
+                unsigned int b = k == 2 ? 1 : 0;
+                ObjTri tri;
+                tri.iv0 = corners[3 * a];
+                tri.iv1 = corners[3 * b];
+                tri.iv2 = corners[3 * k];
                 
-                tri1.ivt0 = vt0 - 1;
-                tri1.ivt1 = vt1 - 1;
-                tri1.ivt2 = vt2 - 1;
+                tri.ivt0 = corners[3 * a + 1];
+                tri.ivt1 = corners[3 * b + 1];
+                tri.ivt2 = corners[3 * k + 1];
                 
-                tri1.ivn0 = vn0 - 1;
-                tri1.ivn1 = vn1 - 1;
-                tri1.ivn2 = vn2 - 1;
-                faces->push_back(tri1);
+                tri.ivn0 = corners[3 * a + 2];
+                tri.ivn1 = corners[3 * b + 2];
+                tri.ivn2 = corners[3 * k + 2];
                 
-                Tri tri2;
-                tri2.iv0 = v2 - 1;
-                tri2.iv1 = v0 - 1;
-                tri2.iv2 = v3 - 1;
-                
-                tri2.ivt0 = vt2 - 1;
-                tri2.ivt1 = vt0 - 1;
-                tri2.ivt2 = vt3 - 1;
-                
-                tri2.ivn0 = vn2 - 1;
-                tri2.ivn1 = vn0 - 1;
-                tri2.ivn2 = vn3 - 1;
-                faces->push_back(tri2);
-            }  
+                uint16_t fields = 0;
+                for (int attr = 0; attr < 3; attr++) {
+                    fields |= ((relative[a] >> attr) & 1) << (3 * attr);
+                    fields |= ((relative[b] >> attr) & 1) << (3 * attr + 1);
+                    fields |= ((relative[k] >> attr) & 1) << (3 * attr + 2);
+                }
+                if (fields) chunk->fixups.push_back(std::make_pair(faces.size(), fields));
+                faces.push_back(tri);
+            }
         }
+        p = skip_line(p, end);
     }
-    fclose(file);
-    printf("Loading completed!\n");
+}
+
+
+static void stitch_obj_chunk(ObjChunk* chunk, ObjData* obj)
+{
+    // Copy into the global buffers at the chunk's prefix-sum offsets.
+    std::copy(chunk->v.begin(), chunk->v.end(), obj->v.begin() + 4 * chunk->base_v);
+    std::copy(chunk->vt.begin(), chunk->vt.end(), obj->vt.begin() + 2 * chunk->base_vt);
+    std::copy(chunk->vn.begin(), chunk->vn.end(), obj->vn.begin() + 4 * chunk->base_vn);
+    std::copy(chunk->faces.begin(), chunk->faces.end(), obj->faces.begin() + chunk->base_f);
+    
+    // Rebase relative indices, which were resolved against chunk-local counts.
+    for (size_t i = 0; i < chunk->fixups.size(); i++) {
+        ObjTri& tri = obj->faces[chunk->base_f + chunk->fixups[i].first];
+        uint16_t fields = chunk->fixups[i].second;
+        unsigned int* index = &tri.iv0;
+        for (int field = 0; field < 9; field++) {
+            if (!(fields & (1 << field))) continue;
+            unsigned long base = field < 3 ? chunk->base_v : (field < 6 ? chunk->base_vt : chunk->base_vn);
+            index[field] += base;
+        }
+    }
+}
+
+
+static inline uint64_t hash_corner(unsigned int iv, unsigned int ivt, unsigned int ivn)
+{
+    uint64_t h = iv * 0x9e3779b97f4a7c15ull;
+    h ^= (ivt + 0x632be59bd9b4e019ull) * 0xc2b2ae3d27d4eb4full + (h << 6) + (h >> 2);
+    h ^= (ivn + 0x165667b19e3779f9ull) * 0xff51afd7ed558ccdull + (h << 6) + (h >> 2);
+    return h ^ (h >> 29);
+}
+
+
+static Mesh* build_indexed_mesh(ObjData* obj)
+{
+    // Hash table from (v, vt, vn) corners to vertex indices, grown as needed.
+    unsigned long capacity = 1024;
+    std::vector<unsigned int> table(capacity, OBJ_NO_INDEX);
+    std::vector<ObjCorner> corners;
+    std::vector<Tri> faces(obj->faces.size());
+    
+    for (size_t i = 0; i < obj->faces.size(); i++) {
+        ObjTri& ot = obj->faces[i];
+        unsigned int* index = &faces[i].i0;
+        for (int k = 0; k < 3; k++) {
+            ObjCorner corner = {(&ot.iv0)[k], (&ot.ivt0)[k], (&ot.ivn0)[k]};
+            
+            // Rehash once the table is half full.
+            if (2 * (corners.size() + 1) > capacity) {
+                capacity *= 2;
+                table.assign(capacity, OBJ_NO_INDEX);
+                for (unsigned int c = 0; c < corners.size(); c++) {
+                    uint64_t slot = hash_corner(corners[c].iv, corners[c].ivt, corners[c].ivn) & (capacity - 1);
+                    while (table[slot] != OBJ_NO_INDEX) slot = (slot + 1) & (capacity - 1);
+                    table[slot] = c;
+                }
+            }
+            
+            // Linear probing for an existing vertex with the same corner.
+            uint64_t slot = hash_corner(corner.iv, corner.ivt, corner.ivn) & (capacity - 1);
+            while (table[slot] != OBJ_NO_INDEX) {
+                ObjCorner& other = corners[table[slot]];
+                if (other.iv == corner.iv && other.ivt == corner.ivt && other.ivn == corner.ivn) break;
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (table[slot] == OBJ_NO_INDEX) {
+                table[slot] = corners.size();
+                corners.push_back(corner);
+            }
+            index[k] = table[slot];
+        }
+    }
+    
+    // Gather attributes of unique corners; missing ones are left zero.
+    unsigned long num_v = obj->v.size() / 4;
+    unsigned long num_vt = obj->vt.size() / 2;
+    unsigned long num_vn = obj->vn.size() / 4;
+    Mesh* mesh = create_mesh(corners.size(), faces.size());
+    float* v = mesh->v->data();
+    float* vt = mesh->vt->data();
+    float* vn = mesh->vn->data();
+    for (size_t c = 0; c < corners.size(); c++) {
+        if (corners[c].iv < num_v) std::copy(&obj->v[4 * corners[c].iv], &obj->v[4 * corners[c].iv + 4], v + 4 * c);
+        else v[4 * c + 3] = 1;
+        if (corners[c].ivt < num_vt) std::copy(&obj->vt[2 * corners[c].ivt], &obj->vt[2 * corners[c].ivt + 2], vt + 2 * c);
+        if (corners[c].ivn < num_vn) std::copy(&obj->vn[4 * corners[c].ivn], &obj->vn[4 * corners[c].ivn + 4], vn + 4 * c);
+    }
+    std::copy(faces.begin(), faces.end(), mesh->f);
+    return mesh;
+}
+
+
+Mesh* load_mesh(const char filename[], unsigned int flags)
+{
+    // Map the whole file; lines may be of any length.
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        printf("Could not open %s\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        printf("Could not open %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+    size_t size = st.st_size;
+    const char* data = (const char*) (size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    
+    // Split the file at newline boundaries into one chunk per job thread.
+    JobSystem* jobs = default_job_system();
+    unsigned long num_chunks = std::min((unsigned long) job_threads(jobs),
+                                        (unsigned long) (size / OBJ_MIN_CHUNK_SIZE) + 1);
+    std::vector<ObjChunk> chunks(num_chunks);
+    const char* end = data + size;
+    const char* p = data;
+    for (unsigned long c = 0; c < num_chunks; c++) {
+        const char* split = c + 1 == num_chunks ? end : data + size * (c + 1) / num_chunks;
+        if (split < p) split = p;
+        if (split < end && split > data && split[-1] != '\n') split = skip_line(split, end);
+        chunks[c].begin = p;
+        chunks[c].end = split;
+        p = split;
+    }
+    
+    // Parse chunks in parallel.
+    parallel_for(jobs, 0, num_chunks, 1, [&chunks](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) parse_obj_chunk(&chunks[c]);
+    });
+    if (size) munmap((void*) data, size);
+    close(fd);
+    
+    // Prefix sums give every chunk its global offsets.
+    unsigned long num_v = 0, num_vt = 0, num_vn = 0, num_f = 0, malformed = 0;
+    for (unsigned long c = 0; c < num_chunks; c++) {
+        chunks[c].base_v = num_v;
+        chunks[c].base_vt = num_vt;
+        chunks[c].base_vn = num_vn;
+        chunks[c].base_f = num_f;
+        num_v += chunks[c].v.size() / 4;
+        num_vt += chunks[c].vt.size() / 2;
+        num_vn += chunks[c].vn.size() / 4;
+        num_f += chunks[c].faces.size();
+        malformed += chunks[c].malformed;
+    }
+    if (malformed) printf("Skipped %ld malformed face lines...\n", malformed);
     
-    Mesh* mesh = new Mesh();
-    mesh->v = vertices;
-    mesh->vt = texcoords;
-    mesh->vn = normals;
-    mesh->f = faces;
+    printf("Loading %ld vertices...\n", num_v);
+    printf("Loading %ld triangle faces...\n", num_f);
+
+    // Stitch chunks into global attribute pools in parallel.
+    ObjData obj;
+    obj.v.resize(4 * num_v);
+    obj.vt.resize(2 * num_vt);
+    obj.vn.resize(4 * num_vn);
+    obj.faces.resize(num_f);
+    parallel_for(jobs, 0, num_chunks, 1, [&chunks, &obj](size_t first, size_t last) {
+        for (size_t c = first; c < last; c++) stitch_obj_chunk(&chunks[c], &obj);
+    });
+    chunks.clear();
+    
+    Mesh* mesh = build_indexed_mesh(&obj);
+    printf("Indexed %ld unique vertices...\n", mesh->num_vertices);
+    compute_mesh_bounds(mesh);
+    if (flags & MESH_OPTIMIZE_ORDER) optimize_vertex_cache(mesh);
+    if (flags & MESH_QUANTIZE) {
+        Mesh* packed = quantize_mesh(mesh);
+        free_mesh(mesh);
+        mesh = packed;
+    }
+    ((MeshFileHeader*) mesh->storage)->flags = flags;
+    printf("Loading completed!\n");
     return mesh;
 }
 
 
 Texture* load_texture(const char filename[]) {
+    // Paged textures are streamed on demand through the shared tile cache.
+    size_t len = strlen(filename);
+    if (len > 5 && strcmp(filename + len - 5, ".vtex") == 0) {
+        VirtualTexture* vt = open_paged_texture(filename, vt_default_cache());
+        if (!vt) return NULL;
+        Texture* tex = new Texture();
+        tex->width = vt->header.width;
+        tex->height = vt->header.height;
+        tex->data = NULL;
+        tex->virt = vt;
+        return tex;
+    }
+
     int width, height, bpp;
     uint8_t* data = stbi_load(filename, &width, &height, &bpp, 3);
+    if (!data) {
+        fprintf(stderr, "Could not load texture %s\n", filename);
+        return NULL;
+    }
+    
+    // Pad by a byte so packet shading can gather whole dwords per texel.
+    data = (uint8_t*) realloc(data, width * height * 3 + 1);
 
     Texture* tex = new Texture();
     tex->width = width;
     tex->height = height;
     tex->data = data;
+    tex->virt = NULL;
 	return tex;
 }
 
 
-Object load_object(const char filename[], const char tex_filename[])
+void free_texture(Texture* tex)
+{
+    if (!tex) return;
+    if (tex->virt) close_paged_texture(tex->virt);
+    free(tex->data);
+    delete tex;
+}
+
+
+Object load_object(const char filename[], const char tex_filename[], unsigned int mesh_flags)
 { 
+    // Decode the texture in a job while the mesh loads here.
+    JobSystem* jobs = default_job_system();
+    JobCounter texture_loaded;
     Object obj;
-    obj.mesh = load_mesh(filename);
-    obj.texture = load_texture(tex_filename);
+    run_job(jobs, [&obj, tex_filename] { obj.texture = load_texture(tex_filename); }, &texture_loaded);
+    obj.mesh = load_mesh_cached(filename, mesh_flags);
+    wait_for_counter(jobs, &texture_loaded);
     return obj;
 }
@@ -10,11 +10,18 @@
 using namespace std;
 
 
-Mesh* load_mesh(const char filename[]);
+// Load-time mesh processing flags.
+#define MESH_OPTIMIZE_ORDER 1       // Reorder triangles/vertices for vertex cache locality.
+#define MESH_QUANTIZE 2             // Store 12-byte quantized vertices instead of 40-byte floats.
+
+
+Mesh* load_mesh(const char filename[], unsigned int flags = 0);
 
 Texture* load_texture(const char filename[]);
 
-Object load_object(const char filename[], const char tex_filename[]);
+void free_texture(Texture* tex);
+
+Object load_object(const char filename[], const char tex_filename[], unsigned int mesh_flags = 0);
 
 
 #endif
@@ -0,0 +1,252 @@
+/* Project ........ Python Game Engine
+ * Filename ....... jobs.c
+ * Description .... Work-stealing job scheduler with job counters and a parallel-for helper.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include "jobs.h"
+#include "profiler.h"
+
+
+// The queue the current thread pushes to, if it is a worker.
+static thread_local JobSystem* worker_system = NULL;
+static thread_local size_t worker_index = 0;
+
+// Set on loader threads and while a background job runs, so the jobs it
+// submits are background too.
+static thread_local bool background_context = false;
+
+
+static size_t own_queue(JobSystem* system)
+{
+    return worker_system == system ? worker_index : system->workers.size();
+}
+
+
+static bool take_job(JobSystem* system, Job* job, bool background)
+{
+    // Newest job from the own queue first, then the oldest from any other,
+    // then background work if the caller may run it.
+    size_t num_queues = system->queues.size();
+    size_t own = own_queue(system);
+    for (size_t k = 0; k < num_queues; k++) {
+        JobQueue* queue = system->queues[(own + k) % num_queues];
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->jobs.empty()) continue;
+        if (k == 0) {
+            *job = std::move(queue->jobs.back());
+            queue->jobs.pop_back();
+        } else {
+            *job = std::move(queue->jobs.front());
+            queue->jobs.pop_front();
+        }
+        system->queued--;
+        return true;
+    }
+    if (!background) return false;
+    std::lock_guard<std::mutex> guard(system->background.lock);
+    if (system->background.jobs.empty()) return false;
+    *job = std::move(system->background.jobs.front());
+    system->background.jobs.pop_front();
+    system->queued--;
+    return true;
+}
+
+
+static void push_job(JobSystem* system, Job job)
+{
+    JobQueue* queue = job.background ? &system->background : system->queues[own_queue(system)];
+    {
+        std::lock_guard<std::mutex> guard(queue->lock);
+        queue->jobs.push_back(std::move(job));
+    }
+    // Pairs with the parking check in worker_main: either the worker sees the job
+    // or this sees the sleeper and wakes it.
+    system->queued++;
+    if (system->sleeping > 0) {
+        std::lock_guard<std::mutex> guard(system->park_lock);
+        system->wake.notify_one();
+    }
+}
+
+
+static void finish_job(JobSystem* system, JobCounter* counter)
+{
+    // Decremented under the lock, so a waiter that saw zero and then took the
+    // lock knows the counter is no longer touched.
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> guard(counter->lock);
+        if (--counter->pending == 0) ready.swap(counter->continuations);
+    }
+    for (size_t i = 0; i < ready.size(); i++) push_job(system, std::move(ready[i]));
+}
+
+
+static void execute_job(JobSystem* system, Job* job)
+{
+    bool outer = background_context;
+    background_context = job->background;
+    job->fn();
+    background_context = outer;
+    if (job->counter) finish_job(system, job->counter);
+}
+
+
+static void worker_main(JobSystem* system, size_t index)
+{
+    PROFILE_THREAD("job worker");
+    worker_system = system;
+    worker_index = index;
+    unsigned int spins = 0;
+    while (!system->stop) {
+        Job job;
+        if (take_job(system, &job, true)) {
+            execute_job(system, &job);
+            spins = 0;
+        } else if (++spins < JOB_SPINS) {
+            std::this_thread::yield();
+        } else {
+            // Park until work is queued, so idle workers cost nothing between frames.
+            std::unique_lock<std::mutex> guard(system->park_lock);
+            system->sleeping++;
+            system->wake.wait(guard, [system] { return system->stop || system->queued > 0; });
+            system->sleeping--;
+            spins = 0;
+        }
+    }
+}
+
+
+JobSystem* create_job_system(unsigned int num_workers)
+{
+    JobSystem* system = new JobSystem();
+    system->queued = 0;
+    system->sleeping = 0;
+    system->stop = false;
+    for (unsigned int i = 0; i <= num_workers; i++) system->queues.push_back(new JobQueue());
+    for (unsigned int i = 0; i < num_workers; i++) {
+        system->workers.push_back(std::thread(worker_main, system, (size_t) i));
+    }
+    return system;
+}
+
+
+JobSystem* default_job_system()
+{
+    // One worker per core besides the calling thread, which helps while it waits.
+    // JOB_WORKERS in the environment overrides the count (0 runs everything inline).
+    static JobSystem* system = NULL;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        unsigned int count = cores - 1;
+        const char* workers = getenv("JOB_WORKERS");
+        if (workers) {
+            char* end;
+            long value = strtol(workers, &end, 10);
+            if (end == workers || *end || value < 0) {
+                fprintf(stderr, "Ignoring JOB_WORKERS=%s; using %u workers\n", workers, count);
+            } else if (value > JOB_MAX_WORKERS) {
+                fprintf(stderr, "JOB_WORKERS=%s is too many; using %d workers\n", workers, JOB_MAX_WORKERS);
+                count = JOB_MAX_WORKERS;
+            } else {
+                count = (unsigned int) value;
+            }
+        }
+        system = create_job_system(count);
+    });
+    return system;
+}
+
+
+void destroy_job_system(JobSystem* system)
+{
+    // Jobs still queued are dropped; wait for their counters first.
+    {
+        std::lock_guard<std::mutex> guard(system->park_lock);
+        system->stop = true;
+    }
+    system->wake.notify_all();
+    for (size_t i = 0; i < system->workers.size(); i++) system->workers[i].join();
+    for (size_t i = 0; i < system->queues.size(); i++) delete system->queues[i];
+    delete system;
+}
+
+
+unsigned int job_threads(JobSystem* system)
+{
+    return system->workers.size() + 1;
+}
+
+
+void set_job_background(bool background)
+{
+    background_context = background;
+}
+
+
+void run_job(JobSystem* system, std::function<void()> fn, JobCounter* counter, JobCounter* after)
+{
+    Job job;
+    job.fn = std::move(fn);
+    job.counter = counter;
+    job.background = background_context;
+    if (counter) counter->pending++;
+
+    // Jobs that depend on a counter are held back until it reaches zero.
+    if (after) {
+        std::lock_guard<std::mutex> guard(after->lock);
+        if (after->pending > 0) {
+            after->continuations.push_back(std::move(job));
+            return;
+        }
+    }
+    // Without workers nobody else would run it.
+    if (system->workers.empty()) execute_job(system, &job);
+    else push_job(system, std::move(job));
+}
+
+
+void wait_for_counter(JobSystem* system, JobCounter* counter)
+{
+    // Help with queued jobs rather than block; back off when there are none
+    // left and the last ones are still running elsewhere. Frame-critical
+    // waits leave background jobs alone, as one may run for a while.
+    unsigned int spins = 0;
+    while (counter->pending > 0) {
+        Job job;
+        if (take_job(system, &job, background_context)) {
+            execute_job(system, &job);
+            spins = 0;
+        } else if (++spins < JOB_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    std::lock_guard<std::mutex> guard(counter->lock);
+}
+
+
+void parallel_for(JobSystem* system, size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+    // Split [begin, end) into ranges of grain items; the caller takes the first.
+    if (begin >= end) return;
+    grain = std::max(grain, (size_t) 1);
+    if (system->workers.empty() || end - begin <= grain) {
+        body(begin, end);
+        return;
+    }
+    JobCounter counter;
+    for (size_t b = begin + grain; b < end; b += grain) {
+        size_t e = std::min(end, b + grain);
+        run_job(system, [&body, b, e] { body(b, e); }, &counter);
+    }
+    body(begin, begin + grain);
+    wait_for_counter(system, &counter);
+}
@@ -0,0 +1,79 @@
+#ifndef _JOBS_H_
+#define _JOBS_H_
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+#define JOB_SPINS 64                    // Failed steals before an idle worker parks.
+#define JOB_MAX_WORKERS 256             // Upper bound on JOB_WORKERS.
+
+
+struct JobCounter;
+
+
+struct Job {
+    std::function<void()> fn;
+    JobCounter* counter;                // Decremented once the job has run; may be NULL.
+    bool background;                    // Submitted from background work (see set_job_background).
+};
+
+
+// Jobs outstanding under a counter, and jobs waiting for it to reach zero.
+// Counters live wherever the waiting code keeps them (usually its stack).
+struct JobCounter {
+    std::atomic<int> pending;
+    std::mutex lock;
+    std::vector<Job> continuations;
+
+    JobCounter() : pending(0) {}
+};
+
+
+// Per-worker deque: its owner pushes and pops at the back (newest first, while
+// the data is hot), idle workers steal from the front (oldest, usually largest).
+struct JobQueue {
+    std::mutex lock;
+    std::deque<Job> jobs;
+};
+
+
+// Work-stealing scheduler shared by loading, vertex processing and rasterization.
+// Threads outside the pool submit to a shared queue and help while they wait.
+// Background jobs have a queue of their own, which workers take from only when
+// the others are empty and which frame-critical waits never run.
+struct JobSystem {
+    std::vector<std::thread> workers;
+    std::vector<JobQueue*> queues;      // One per worker, then the shared one.
+    JobQueue background;
+    std::atomic<int> queued;
+    std::atomic<int> sleeping;
+    std::mutex park_lock;
+    std::condition_variable wake;
+    std::atomic<bool> stop;
+};
+
+
+JobSystem* create_job_system(unsigned int num_workers);
+
+JobSystem* default_job_system();
+
+void destroy_job_system(JobSystem* system);
+
+unsigned int job_threads(JobSystem* system);
+
+void set_job_background(bool background);
+
+void run_job(JobSystem* system, std::function<void()> fn, JobCounter* counter = NULL, JobCounter* after = NULL);
+
+void wait_for_counter(JobSystem* system, JobCounter* counter);
+
+void parallel_for(JobSystem* system, size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+
+#endif
@@ -3,9 +3,10 @@
  * Description .... Test file to try out features.
  * Created by ..... Thomas Bellucci
  * Date ........... Dec 20th, 2020
- * Compile ........ g++ -O3 -g -o main main.c shading.c rasterization.c camera.c imports.c -lglfw -lGL
+ * Compile ........ g++ -O3 -g -march=native -o main main.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c streaming.c assets.c backend.c profiler.c capture.c -lglfw -lGL -lpthread
+ *                  (headless only: add -DNO_GLFW and drop -lglfw -lGL; timing zones: add -DPROFILE;
+ *                  rasterizer counters and --overdraw: add -DRASTER_STATS)
  */ 
-#include <GLFW/glfw3.h>
 #include <iostream>
 #include <cstring>
 #include <math.h>
@@ -14,6 +15,12 @@
 #include "imports.h"
 #include "camera.h"
 #include "rasterization.h"
+#include "vtexture.h"
+#include "assets.h"
+#include "backend.h"
+#include "profiler.h"
+#include "capture.h"
+#include "streaming.h"
 using namespace std;
 
 
@@ -24,13 +31,98 @@ const float FOV = 35;
 const float MIN_DRAW_DIST = 0.01f;
 const float MAX_DRAW_DIST = 100.0f;
 
+// Scene
+const char SCENE_MESH[] = "models/Scene2.obj";
+const char SCENE_TEXTURE[] = "textures/Scene2_baked.png";
+const unsigned int SCENE_MESH_FLAGS = MESH_OPTIMIZE_ORDER;
+const double STREAM_BUDGET_MB = 64;     // Chunk memory for --stream unless --budget is given.
 
 
-int main(void)
+
+int main(int argc, char* argv[])
 {
-    // Load object and its texture.
-    Object obj = load_object("models/Scene2.obj",
-                             "textures/Scene2_baked.png");
+    // Parse options; --headless renders N frames without a window (0 = forever).
+    bool headless = false;
+    unsigned long num_frames = 0;
+    int output = OUTPUT_NONE;
+    const char* prefix = "frame";
+    const char* trace_filename = NULL;
+    bool overdraw = false;
+    bool counters = false;
+    const char* capture_filename = NULL;
+    const char* stream_filename = NULL;
+    double budget_mb = STREAM_BUDGET_MB;
+    double mesh_budget_mb = 0, texture_budget_mb = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            headless = true;
+            num_frames = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = parse_output_format(argv[++i]);
+        } else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else if (strcmp(argv[i], "--overdraw") == 0) {
+            overdraw = true;
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_filename = argv[++i];
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            stream_filename = argv[++i];
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mesh-budget") == 0 && i + 1 < argc) {
+            mesh_budget_mb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+            texture_budget_mb = atof(argv[++i]);
+        } else {
+            output = -1;
+        }
+    }
+    if (output < 0) {
+        printf("usage: %s [--headless N] [--output none|ppm|png|raw] [--prefix path] [--trace file.json] [--overdraw] [--counters] [--capture file.fcap]\n"
+               "       [--stream mesh.smesh [--budget MB]] [--mesh-budget MB] [--texture-budget MB]\n", argv[0]);
+        return 1;
+    }
+    
+    // Open the window, or render offscreen. This comes first, as raw frames sent to
+    // stdout move all other output to stderr.
+    Backend* backend = headless ? create_headless_backend(FRAME_WIDTH, FRAME_HEIGHT, output, prefix, num_frames)
+                                : create_window_backend(FRAME_WIDTH, FRAME_HEIGHT, "");
+    if (!backend) return -1;
+    if (trace_filename && !profile_enabled()) printf("Built without -DPROFILE; the trace will be empty\n");
+    PROFILE_THREAD("main");
+    if (counters && !profile_enabled()) printf("Built without -DPROFILE; there are no zones to count\n");
+    if (counters && profile_enabled()) profile_enable_counters();
+    
+    // Assets past their type's budget are evicted least recently used first (0 = unlimited).
+    set_asset_budget(ASSET_MESH, (size_t) (mesh_budget_mb * 1024 * 1024));
+    set_asset_budget(ASSET_TEXTURE, (size_t) (texture_budget_mb * 1024 * 1024));
+    
+    // Load object and its texture in the background.
+    AsyncObject* scene = load_object_async(SCENE_MESH, SCENE_TEXTURE, SCENE_MESH_FLAGS);
+    
+    // Headless runs are for measurement, so they start from fully loaded assets.
+    if (headless) {
+        wait_object(scene);
+        if (object_failed(scene)) {
+            printf("Could not load %s / %s\n", SCENE_MESH, SCENE_TEXTURE);
+            return 1;
+        }
+    }
+    
+    // A streaming mesh replaces the scene mesh; chunks are paged in under the budget.
+    StreamingMesh* smesh = NULL;
+    if (stream_filename) {
+        smesh = open_streaming_mesh(stream_filename, (size_t) (budget_mb * 1024 * 1024));
+        if (!smesh) {
+            printf("Could not open %s\n", stream_filename);
+            return 1;
+        }
+        if (capture_filename) printf("Captures do not record streaming meshes; --capture is ignored\n");
+    }
     
     // Create a camera  
     Eigen::Vector3f origin;
@@ -40,6 +132,7 @@ int main(void)
     direction = -origin.normalized();
     
     Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, origin, direction, FOV, MIN_DRAW_DIST, MAX_DRAW_DIST);
+    if (overdraw && !set_camera_view(&cam, VIEW_OVERDRAW)) printf("Built without -DRASTER_STATS; --overdraw is ignored\n");
     
     // Define rotation matrix
     float theta = -0.02f;
@@ -48,42 +141,89 @@ int main(void)
          sin(theta), cos(theta), 0,
          0, 0, 1;
     
-    // Initialize the library and create the window.
-    if (!glfwInit()) return -1;
-    GLFWwindow* window = glfwCreateWindow(FRAME_WIDTH, FRAME_HEIGHT, "", NULL, NULL);
-    if (!window) {
-        glfwTerminate();
-        return -1;
+    // Record camera and draws of every frame for replay (see replay.c).
+    CaptureWriter* capture = NULL;
+    unsigned int capture_scene = 0;
+    if (capture_filename && !smesh) {
+        capture = begin_capture(capture_filename, FRAME_WIDTH, FRAME_HEIGHT, FOV, MIN_DRAW_DIST, MAX_DRAW_DIST);
+        if (!capture) printf("Could not write %s\n", capture_filename);
+        else capture_scene = capture_asset(capture, SCENE_MESH, SCENE_TEXTURE, SCENE_MESH_FLAGS);
     }
 
-    // Loop until the user closes the window.
-    glfwMakeContextCurrent(window);
-    while (!glfwWindowShouldClose(window)) {
-        // Clear buffers.
-        reset_camera(cam);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
+    // Frame time is reported as an average about once a second (see bench.c for detail).
+    double busy_seconds = 0;
+    unsigned long frames = 0;
+    auto report = std::chrono::high_resolution_clock::now();
+    bool scene_loaded = false;
+
+    // Loop until the user closes the window or all frames are rendered.
+    while (backend_running(backend)) {
         // Render scene and time execution.
+        PROFILE_ZONE("frame");
         auto start = std::chrono::high_resolution_clock::now();
         
+        // Clear buffers.
+        reset_camera(&cam);
+        
         // Render scene
         origin = R * origin;
         direction = -origin.normalized();
         move_camera(&cam, origin, direction);
-        rasterize_mesh(&cam, &obj);
+        Object obj = current_object(scene);
+        use_object(&obj);
+        if (!scene_loaded && object_ready(scene)) {
+            scene_loaded = true;
+            if (object_failed(scene)) printf("Could not load %s / %s; drawing a placeholder\n", SCENE_MESH, SCENE_TEXTURE);
+        }
+        if (smesh) {
+            update_streaming_mesh(smesh, &cam);
+            rasterize_streaming_mesh(&cam, smesh, obj.texture);
+        } else {
+            rasterize_mesh(&cam, &obj);
+        }
+        if (capture && scene_loaded) {
+            // Frames before the scene has loaded draw a placeholder, which replay cannot.
+            capture_frame(capture, &cam);
+            capture_draw(capture, capture_scene, &obj);
+        }
         
+        // Stream in texture tiles requested by this frame and apply asset budgets.
+        if (obj.texture->virt) vt_update(obj.texture->virt->cache);
+        update_assets();
+        
+        // Present the frame.
+        resolve_camera(&cam);
         auto finish = std::chrono::high_resolution_clock::now();
-        int dur = std::chrono::duration_cast<std::chrono::nanoseconds>(finish-start).count();
-        printf("fps: %f\n", 1 / (dur* pow(10, -9)));
+        present_frame(backend, &cam);
+        
+        busy_seconds += std::chrono::duration<double>(finish - start).count();
+        frames++;
+        if (std::chrono::duration<double>(finish - report).count() >= 1) {
+            printf("fps: %.1f (%.2f ms/frame)\n", frames / busy_seconds, 1000 * busy_seconds / frames);
+#ifdef RASTER_STATS
+            print_raster_stats(stdout, &cam.stats, frames);
+            reset_raster_stats(&cam);
+#endif
+            busy_seconds = 0;
+            frames = 0;
+            report = finish;
+        }
+    }
 
-        // Swap front and back buffers.
-        glDrawPixels(FRAME_WIDTH, FRAME_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, cam.frame_buffer);
-        glfwSwapBuffers(window);
+    if (capture) end_capture(capture);
+    if (smesh) close_streaming_mesh(smesh);
 
-        // Poll for and process events.
-        glfwPollEvents();
+    // Memory held by the asset cache, while the scene is still in it.
+    print_asset_report(stdout);
+    release_async_object(scene);
+    destroy_camera(&cam);
+    destroy_backend(backend);
+    
+    // Zones of the last frames, per thread, for chrome://tracing or Perfetto.
+    if (profile_enabled()) print_profile_report(stdout);
+    if (trace_filename && write_chrome_trace(trace_filename) != 0) {
+        printf("Could not write %s\n", trace_filename);
+        return 1;
     }
-
-    glfwTerminate();
     return 0;
 }
@@ -0,0 +1,71 @@
+/* Project ........ Python Game Engine
+ * Filename ....... meshconv.c
+ * Description .... Prebuilds binary mesh caches (.mcache) or streaming meshes (.smesh) next to OBJ files.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -o meshconv meshconv.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c streaming.c rasterization.c shading.c camera.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+#include "imports.h"
+#include "meshfile.h"
+#include "streaming.h"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("usage: %s [--verify] [--optimize] [--quantize] [--stream [--chunk-faces N]] <mesh.obj>...\n", argv[0]);
+        return 1;
+    }
+    bool verify = false;
+    bool stream = false;
+    unsigned int chunk_faces = SMESH_DEFAULT_CHUNK_FACES;
+    unsigned int flags = 0;
+    int first = 1;
+    for (; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+        if (strcmp(argv[first], "--verify") == 0) verify = true;
+        else if (strcmp(argv[first], "--optimize") == 0) flags |= MESH_OPTIMIZE_ORDER;
+        else if (strcmp(argv[first], "--quantize") == 0) flags |= MESH_QUANTIZE;
+        else if (strcmp(argv[first], "--stream") == 0) stream = true;
+        else if (strcmp(argv[first], "--chunk-faces") == 0 && first + 1 < argc) chunk_faces = std::max(1, atoi(argv[++first]));
+    }
+    int failures = 0;
+
+    for (int i = first; i < argc; i++) {
+        std::string cache_filename = mesh_cache_filename(argv[i], flags);
+
+        // Check an existing cache against the full checksum of its source.
+        if (verify) {
+            Mesh* mesh = map_mesh_file(cache_filename.c_str(), NULL);
+            bool ok = mesh && ((MeshFileHeader*) mesh->storage)->source_checksum == checksum_file(argv[i]);
+            printf("%s: %s\n", cache_filename.c_str(), ok ? "up to date" : "stale or missing");
+            if (mesh) free_mesh(mesh);
+            failures += !ok;
+            continue;
+        }
+
+        // Split the mesh into spatial chunks for out-of-core rendering.
+        if (stream) {
+            std::string stream_filename = std::string(argv[i]) + SMESH_EXTENSION;
+            if (build_streaming_mesh(argv[i], stream_filename.c_str(), chunk_faces) != 0) {
+                printf("Failed to convert %s\n", argv[i]);
+                failures++;
+            }
+            continue;
+        }
+
+        Mesh* mesh = load_mesh(argv[i], flags);
+        if (!mesh || write_mesh_file(mesh, cache_filename.c_str(), argv[i]) != 0) {
+            printf("Failed to convert %s\n", argv[i]);
+            failures++;
+        } else {
+            printf("Wrote %s\n", cache_filename.c_str());
+        }
+        if (mesh) free_mesh(mesh);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+/* Project ........ Python Game Engine
+ * Filename ....... meshfile.c
+ * Description .... Binary mesh format used for mesh storage and on-disk mesh caches.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <atomic>
+#include <Eigen/Dense>
+#include "types.h"
+#include "imports.h"
+#include "meshfile.h"
+
+
+static inline uint64_t align_offset(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t) (MESH_FILE_ALIGNMENT - 1);
+}
+
+
+Mesh* wrap_mesh_storage(void* storage, size_t size, bool mapped)
+{
+    // Point the mesh streams into the storage block.
+    MeshFileHeader* header = (MeshFileHeader*) storage;
+    uint8_t* base = (uint8_t*) storage;
+    Mesh* mesh = new Mesh();
+    if (header->flags & MESH_QUANTIZE) {
+        mesh->qv = (uint16_t*) (base + header->v_offset);
+        mesh->qvt = (uint16_t*) (base + header->vt_offset);
+        mesh->qvn = (uint16_t*) (base + header->vn_offset);
+        for (int k = 0; k < 3; k++) {
+            mesh->qscale[k] = (header->bounds_max[k] - header->bounds_min[k]) / 65535;
+            mesh->qoffset[k] = header->bounds_min[k];
+        }
+    } else {
+        mesh->v = new Eigen::Map<Eigen::MatrixXf>((float*) (base + header->v_offset), 4, header->num_vertices);
+        mesh->vt = new Eigen::Map<Eigen::MatrixXf>((float*) (base + header->vt_offset), 2, header->num_vertices);
+        mesh->vn = new Eigen::Map<Eigen::MatrixXf>((float*) (base + header->vn_offset), 4, header->num_vertices);
+    }
+    mesh->f = (Tri*) (base + header->f_offset);
+    mesh->num_vertices = header->num_vertices;
+    mesh->num_faces = header->num_faces;
+    mesh->storage = storage;
+    mesh->storage_size = size;
+    mesh->mapped = mapped;
+    return mesh;
+}
+
+
+Mesh* create_mesh(unsigned long num_vertices, unsigned long num_faces, unsigned int flags)
+{
+    // Lay out aligned streams after the header.
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+    header.version = MESH_FILE_VERSION;
+    header.converter_version = MESH_CONVERTER_VERSION;
+    header.num_vertices = num_vertices;
+    header.num_faces = num_faces;
+    header.flags = flags;
+    
+    // Stream sizes per vertex: 16 + 8 + 16 bytes as floats, 6 + 4 + 2 quantized.
+    bool quantized = flags & MESH_QUANTIZE;
+    header.v_offset = align_offset(sizeof(MeshFileHeader));
+    header.vt_offset = align_offset(header.v_offset + (quantized ? 6 : 16) * num_vertices);
+    header.vn_offset = align_offset(header.vt_offset + (quantized ? 4 : 8) * num_vertices);
+    header.f_offset = align_offset(header.vn_offset + (quantized ? 2 : 16) * num_vertices);
+    header.total_size = align_offset(header.f_offset + sizeof(Tri) * num_faces);
+
+    void* storage = aligned_alloc(MESH_FILE_ALIGNMENT, header.total_size);
+    memset(storage, 0, header.total_size);
+    memcpy(storage, &header, sizeof(header));
+    return wrap_mesh_storage(storage, header.total_size, false);
+}
+
+
+void free_mesh(Mesh* mesh)
+{
+    delete mesh->v;
+    delete mesh->vt;
+    delete mesh->vn;
+    if (mesh->mapped) munmap(mesh->storage, mesh->storage_size);
+    else free(mesh->storage);
+    delete mesh;
+}
+
+
+void compute_mesh_bounds(Mesh* mesh)
+{
+    // Bounding box of all vertices, kept in the (heap) storage header.
+    MeshFileHeader* header = (MeshFileHeader*) mesh->storage;
+    for (int k = 0; k < 3; k++) {
+        header->bounds_min[k] = mesh->num_vertices ? mesh->v->row(k).minCoeff() : 0;
+        header->bounds_max[k] = mesh->num_vertices ? mesh->v->row(k).maxCoeff() : 0;
+    }
+}
+
+
+uint64_t checksum_file(const char filename[])
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    // FNV-1a over the whole file.
+    uint64_t hash = 14695981039346656037ull;
+    if (st.st_size > 0) {
+        uint8_t* data = (uint8_t*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            for (off_t i = 0; i < st.st_size; i++) {
+                hash ^= data[i];
+                hash *= 1099511628211ull;
+            }
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+    return hash;
+}
+
+
+int write_mesh_file(Mesh* mesh, const char filename[], const char src_filename[])
+{
+    MeshFileHeader header;
+    memcpy(&header, mesh->storage, sizeof(header));
+
+    // Identify the source so stale caches can be detected.
+    struct stat st;
+    if (src_filename && stat(src_filename, &st) == 0) {
+        header.source_size = st.st_size;
+        header.source_mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        header.source_checksum = checksum_file(src_filename);
+    }
+
+    // Write to a temporary file and rename, so readers never see a partial cache.
+    // The name is unique per call as several loader threads may write the same cache.
+    static std::atomic<unsigned int> counter(0);
+    std::string tmp_filename = std::string(filename) + ".tmp" + std::to_string(getpid()) + "." + std::to_string(counter++);
+    FILE* file = fopen(tmp_filename.c_str(), "wb");
+    if (!file) return -1;
+    size_t body = header.total_size - sizeof(header);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+              && fwrite((uint8_t*) mesh->storage + sizeof(header), 1, body, file) == body;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmp_filename.c_str(), filename) != 0) {
+        remove(tmp_filename.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+
+static bool stream_fits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size)
+{
+    // An aligned stream between the header and the end of the file (without overflow).
+    return offset >= sizeof(MeshFileHeader) && offset % MESH_FILE_ALIGNMENT == 0 && offset <= size
+           && count <= (size - offset) / stride;
+}
+
+
+bool valid_mesh_storage(const void* storage, uint64_t size)
+{
+    // Reject foreign, outdated or truncated storage; every stream must lie within it.
+    if (size < sizeof(MeshFileHeader)) return false;
+    const MeshFileHeader* header = (const MeshFileHeader*) storage;
+    if (memcmp(header->magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0 || header->version != MESH_FILE_VERSION
+        || header->converter_version != MESH_CONVERTER_VERSION || header->total_size != size) {
+        return false;
+    }
+    bool quantized = header->flags & MESH_QUANTIZE;
+    uint64_t n = header->num_vertices;
+    return stream_fits(header->v_offset, n, quantized ? 6 : 16, size)
+           && stream_fits(header->vt_offset, n, quantized ? 4 : 8, size)
+           && stream_fits(header->vn_offset, n, quantized ? 2 : 16, size)
+           && stream_fits(header->f_offset, header->num_faces, sizeof(Tri), size);
+}
+
+
+Mesh* map_mesh_file(const char filename[], const char src_filename[])
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(MeshFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void* storage = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (storage == MAP_FAILED) return NULL;
+
+    MeshFileHeader* header = (MeshFileHeader*) storage;
+    bool valid = valid_mesh_storage(storage, st.st_size);
+
+    // Reject caches whose source changed since conversion.
+    struct stat src;
+    if (valid && src_filename && stat(src_filename, &src) == 0) {
+        int64_t mtime = (int64_t) src.st_mtim.tv_sec * 1000000000 + src.st_mtim.tv_nsec;
+        valid = header->source_size == (uint64_t) src.st_size && header->source_mtime == mtime;
+    }
+    if (!valid) {
+        munmap(storage, st.st_size);
+        return NULL;
+    }
+    return wrap_mesh_storage(storage, st.st_size, true);
+}
+
+
+std::string mesh_cache_filename(const char filename[], unsigned int flags)
+{
+    // One cache per set of load flags, so callers loading the same source
+    // differently do not overwrite each other's.
+    return std::string(filename) + "." + std::to_string(flags) + MESH_CACHE_EXTENSION;
+}
+
+
+Mesh* load_mesh_cached(const char filename[], unsigned int flags)
+{
+    // Use the cache next to the source when it is up to date and built the same way.
+    std::string cache_filename = mesh_cache_filename(filename, flags);
+    Mesh* mesh = map_mesh_file(cache_filename.c_str(), filename);
+    if (mesh && ((MeshFileHeader*) mesh->storage)->flags == flags) return mesh;
+    if (mesh) free_mesh(mesh);
+
+    // Otherwise parse, write the cache and switch to the mapped copy.
+    mesh = load_mesh(filename, flags);
+    if (!mesh) return NULL;
+    if (write_mesh_file(mesh, cache_filename.c_str(), filename) == 0) {
+        Mesh* mapped = map_mesh_file(cache_filename.c_str(), filename);
+        if (mapped) {
+            free_mesh(mesh);
+            return mapped;
+        }
+    }
+    return mesh;
+}
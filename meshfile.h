@@ -0,0 +1,60 @@
+#ifndef _MESHFILE_H_
+#define _MESHFILE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "types.h"
+
+
+#define MESH_FILE_MAGIC "MESHC01"
+#define MESH_FILE_VERSION 4
+#define MESH_CONVERTER_VERSION 2
+#define MESH_FILE_ALIGNMENT 64
+#define MESH_CACHE_EXTENSION ".mcache"   // After the source name and load flags: Scene.obj.1.mcache.
+
+
+// Header of the binary mesh format. The same layout backs meshes in memory,
+// so a cache file can be mapped and used in place without parsing or copying.
+struct MeshFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t converter_version;
+    uint32_t flags;                 // MESH_* load flags the mesh was built with.
+    uint32_t reserved;
+    uint64_t total_size;
+    uint64_t num_vertices;
+    uint64_t num_faces;
+    uint64_t v_offset;              // 4 x num_vertices floats, column-major (quantized: 3 uint16 planes).
+    uint64_t vt_offset;             // 2 x num_vertices floats, column-major (quantized: half pairs).
+    uint64_t vn_offset;             // 4 x num_vertices floats, column-major (quantized: octahedral uint16).
+    uint64_t f_offset;              // num_faces Tri records.
+    float bounds_min[3];
+    float bounds_max[3];
+    uint64_t source_size;
+    int64_t source_mtime;           // Nanoseconds since the epoch.
+    uint64_t source_checksum;       // FNV-1a 64 of the source OBJ.
+};
+
+
+bool valid_mesh_storage(const void* storage, uint64_t size);
+
+Mesh* wrap_mesh_storage(void* storage, size_t size, bool mapped);
+
+Mesh* create_mesh(unsigned long num_vertices, unsigned long num_faces, unsigned int flags = 0);
+
+void compute_mesh_bounds(Mesh* mesh);
+
+void free_mesh(Mesh* mesh);
+
+uint64_t checksum_file(const char filename[]);
+
+int write_mesh_file(Mesh* mesh, const char filename[], const char src_filename[]);
+
+Mesh* map_mesh_file(const char filename[], const char src_filename[]);
+
+std::string mesh_cache_filename(const char filename[], unsigned int flags);
+
+Mesh* load_mesh_cached(const char filename[], unsigned int flags = 0);
+
+
+#endif
@@ -0,0 +1,367 @@
+/* Project ........ Python Game Engine
+ * Filename ....... microbench.c
+ * Description .... Microbenchmarks of the hot kernels in isolation on synthetic inputs.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -DNO_GLFW -o microbench microbench.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c backend.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <Eigen/Dense>
+#include "types.h"
+#include "imports.h"
+#include "camera.h"
+#include "shading.h"
+#include "rasterization.h"
+#include "meshfile.h"
+#include "quantize.h"
+#include "backend.h"
+#include "stb_image.h"
+
+
+const int FRAME_WIDTH = 640;
+const int FRAME_HEIGHT = 480;
+const float FOV = 35;
+
+#define MICROBENCH_REPS 5
+
+
+struct MicroResult {
+    std::string kernel;
+    std::string params;
+    double value;
+    const char* unit;
+};
+
+
+static std::vector<MicroResult> results;
+static volatile double sink;        // Keeps results alive so kernels are not optimised away.
+
+
+template <typename Fn> static double best_seconds(Fn fn)
+{
+    // Best of several runs filters out scheduling noise.
+    double best = 1e30;
+    for (int r = 0; r < MICROBENCH_REPS; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto finish = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(finish - start).count());
+    }
+    return best;
+}
+
+
+static void report(const char* kernel, std::string params, double value, const char* unit)
+{
+    MicroResult result = {kernel, params, value, unit};
+    results.push_back(result);
+    printf("%-10s %-28s %10.2f %s\n", kernel, params.c_str(), value, unit);
+}
+
+
+static Texture* make_texture(int size)
+{
+    // Random texels, padded by a byte like loaded textures.
+    Texture* tex = new Texture();
+    tex->width = size;
+    tex->height = size;
+    tex->data = (uint8_t*) malloc((size_t) size * size * 3 + 1);
+    for (size_t i = 0; i < (size_t) size * size * 3 + 1; i++) tex->data[i] = rand();
+    tex->virt = NULL;
+    return tex;
+}
+
+
+static void bench_edge()
+{
+    // Edge function evaluations across a frame.
+    Eigen::Vector3f v0(10, 20, -1), v1(600, 40, -1);
+    double seconds = best_seconds([&] {
+        double sum = 0;
+        for (int y = 0; y < FRAME_HEIGHT; y++) {
+            for (int x = 0; x < FRAME_WIDTH; x++) sum += f(v0, v1, x, y);
+        }
+        sink = sum;
+    });
+    report("edge", "640x480", seconds * 1e9 / (FRAME_WIDTH * FRAME_HEIGHT), "ns/eval");
+}
+
+
+static void bench_raster()
+{
+    // Right triangles tiling the frame in layers, drawn back to front so every layer passes
+    // the depth test: triangle size sets setup cost, overdraw sets fill cost.
+    Texture* tex = make_texture(256);
+    Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(0, 1, 0), FOV, 0.01f, 100.0f);
+    int sizes[] = {2, 8, 32, 128};
+    int overdraws[] = {1, 4};
+    for (int si = 0; si < 4; si++) {
+        for (int oi = 0; oi < 2; oi++) {
+            int size = sizes[si], overdraw = overdraws[oi];
+            int cols = FRAME_WIDTH / size, rows = FRAME_HEIGHT / size;
+            unsigned long num_tris = (unsigned long) cols * rows * 2 * overdraw;
+            Eigen::MatrixXf v(3, num_tris * 3), vn(4, num_tris * 3);
+            Eigen::MatrixXf uv(2, num_tris * 3);
+            vn.setZero();
+            vn.row(2).setOnes();
+            std::vector<Tri> tris;
+            unsigned int n = 0;
+            for (int layer = 0; layer < overdraw; layer++) {
+                float z = -0.5f - (overdraw - layer) * 0.1f;
+                for (int r = 0; r < rows; r++) {
+                    for (int c = 0; c < cols; c++) {
+                        float x0 = c * size, y0 = r * size, x1 = x0 + size, y1 = y0 + size;
+                        float quad[4][2] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+                        int corners[2][3] = {{0, 1, 2}, {0, 2, 3}};
+                        for (int t = 0; t < 2; t++) {
+                            Tri tri = {n, n + 1, n + 2};
+                            for (int k = 0; k < 3; k++, n++) {
+                                v.col(n) << quad[corners[t][k]][0], quad[corners[t][k]][1], z;
+                                uv.col(n) << quad[corners[t][k]][0] / FRAME_WIDTH, quad[corners[t][k]][1] / FRAME_HEIGHT;
+                            }
+                            tris.push_back(tri);
+                        }
+                    }
+                }
+            }
+            Eigen::Map<Eigen::MatrixXf> vt(uv.data(), 2, num_tris * 3);
+            double seconds = best_seconds([&] {
+                reset_camera(&cam);
+                for (size_t i = 0; i < tris.size(); i++) rasterize_mesh_triangle(&cam, &v, &vn, &vt, tris[i], tex);
+            });
+            std::string params = "tri " + std::to_string(size) + "px, overdraw " + std::to_string(overdraw);
+            report("raster", params, (double) cols * rows * size * size * overdraw / seconds / 1e6, "Mpix/s");
+            report("raster", params, seconds * 1e9 / num_tris, "ns/tri");
+        }
+    }
+    destroy_camera(&cam);
+    free_texture(tex);
+}
+
+
+static void bench_texture()
+{
+    // Random texture coordinates: larger textures fall out of cache.
+    int sizes[] = {256, 1024, 4096};
+    const int count = 1 << 20;
+    std::vector<Eigen::Vector2f> coords(count);
+    for (int i = 0; i < count; i++) coords[i] = Eigen::Vector2f(rand() / (float) RAND_MAX, rand() / (float) RAND_MAX);
+    for (int si = 0; si < 3; si++) {
+        Texture* tex = make_texture(sizes[si]);
+        std::string params = std::to_string(sizes[si]) + "x" + std::to_string(sizes[si]);
+        double seconds = best_seconds([&] {
+            unsigned long sum = 0;
+            for (int i = 0; i < count; i++) sum += tex->data[texture_lookup(tex, &coords[i])];
+            sink = sum;
+        });
+        report("lookup", params, count / seconds / 1e6, "M/s");
+
+        Eigen::Vector3f pixel, vertex(0, 0, -1), normal(0, 0, 1);
+        seconds = best_seconds([&] {
+            double sum = 0;
+            for (int i = 0; i < count; i++) {
+                shade_pixel(&pixel, &vertex, &normal, &coords[i], tex, 0);
+                sum += pixel(0);
+            }
+            sink = sum;
+        });
+        report("shade", params, count / seconds / 1e6, "M/s");
+
+        // Packets of 8 pixels interpolating across one random triangle each.
+        alignas(32) float alpha[PACKET_SIZE], beta[PACKET_SIZE], gamma[PACKET_SIZE];
+        alignas(32) uint32_t dst[PACKET_SIZE];
+        for (int j = 0; j < PACKET_SIZE; j++) {
+            alpha[j] = (j + .5f) / PACKET_SIZE;
+            beta[j] = (1 - alpha[j]) / 2;
+            gamma[j] = 1 - alpha[j] - beta[j];
+        }
+        seconds = best_seconds([&] {
+            for (int i = 0; i + 2 < count; i += PACKET_SIZE) {
+                shade_packet(dst, 0xff, alpha, beta, gamma, &coords[i], &coords[i + 1], &coords[i + 2], tex);
+            }
+            sink = dst[0];
+        });
+        report("packet", params, count / seconds / 1e6, "Mpix/s");
+        free_texture(tex);
+    }
+}
+
+
+static void bench_transform()
+{
+    // Meshes without faces, so rasterize_mesh only transforms vertices.
+    Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, Eigen::Vector3f(5, -5, 5), Eigen::Vector3f(-1, 1, -1).normalized(), FOV, 0.01f, 100.0f);
+    unsigned long counts[] = {1000, 100000, 1000000};
+    for (int ci = 0; ci < 3; ci++) {
+        Mesh* mesh = create_mesh(counts[ci], 0);
+        mesh->v->setRandom();
+        mesh->v->row(3).setOnes();
+        mesh->vn->setRandom();
+        mesh->vn->row(3).setZero();
+        mesh->vt->setRandom();
+        Mesh* packed = quantize_mesh(mesh);
+        Mesh* variants[2] = {mesh, packed};
+        const char* names[2] = {"float", "quantized"};
+        for (int q = 0; q < 2; q++) {
+            Object obj = {variants[q], NULL};
+            double seconds = best_seconds([&] { rasterize_mesh(&cam, &obj); });
+            report("transform", std::to_string(counts[ci]) + " verts, " + names[q], counts[ci] / seconds / 1e6, "Mverts/s");
+        }
+        free_mesh(packed);
+        free_mesh(mesh);
+    }
+    destroy_camera(&cam);
+}
+
+
+static void bench_clear()
+{
+    // Full streaming-store clear, and the lazy clear plus resolve of an empty frame.
+    int resolutions[3][2] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+    for (int ri = 0; ri < 3; ri++) {
+        int w = resolutions[ri][0], h = resolutions[ri][1];
+        Camera cam = create_camera(w, h, Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(0, 1, 0), FOV, 0.01f, 100.0f);
+        std::string params = std::to_string(w) + "x" + std::to_string(h);
+        double bytes = (double) cam.tiles_x * cam.tiles_y * TILE_PIXELS * (sizeof(uint32_t) + sizeof(float));
+        double seconds = best_seconds([&] { clear_camera(&cam); });
+        report("clear", params, bytes / seconds / 1e9, "GB/s");
+        seconds = best_seconds([&] {
+            reset_camera(&cam);
+            resolve_camera(&cam);
+        });
+        report("reset", params + " +resolve", seconds * 1e3, "ms");
+        destroy_camera(&cam);
+    }
+}
+
+
+static void bench_parse()
+{
+    // Synthetic grid meshes written as OBJ, parsed with load_mesh.
+    int grids[] = {100, 1000};
+    for (int gi = 0; gi < 2; gi++) {
+        int n = grids[gi];
+        std::string filename = "/tmp/microbench_" + std::to_string(getpid()) + ".obj";
+        FILE* file = fopen(filename.c_str(), "w");
+        if (!file) return;
+        for (int y = 0; y <= n; y++) {
+            for (int x = 0; x <= n; x++) {
+                fprintf(file, "v %f %f %f\nvt %f %f\n", x / (float) n, y / (float) n, 0.01f * ((x * 7 + y * 13) % 17), x / (float) n, y / (float) n);
+            }
+        }
+        fprintf(file, "vn 0 0 1\n");
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                int i = y * (n + 1) + x + 1;
+                fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", i, i, i + 1, i + 1, i + n + 2, i + n + 2);
+                fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", i, i, i + n + 2, i + n + 2, i + n + 1, i + n + 1);
+            }
+        }
+        fclose(file);
+        struct stat st;
+        stat(filename.c_str(), &st);
+
+        // load_mesh logs progress; keep it out of the report.
+        fflush(stdout);
+        int saved = dup(1), null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        double seconds = best_seconds([&] { free_mesh(load_mesh(filename.c_str())); });
+        fflush(stdout);
+        dup2(saved, 1);
+        close(saved);
+        close(null);
+        report("parse", std::to_string(2 * n * n) + " tris", st.st_size / seconds / (1024 * 1024), "MB/s");
+        remove(filename.c_str());
+    }
+}
+
+
+static void bench_decode()
+{
+    // PNGs written by write_png use stored deflate blocks, so this measures the decoder's
+    // inflate, unfiltering and conversion rather than entropy decoding.
+    int sizes[] = {256, 1024, 2048};
+    for (int si = 0; si < 3; si++) {
+        Texture* tex = make_texture(sizes[si]);
+        std::string filename = "/tmp/microbench_" + std::to_string(getpid()) + ".png";
+        write_png(filename.c_str(), tex->data, tex->width, tex->height);
+        double seconds = best_seconds([&] {
+            int w, h, bpp;
+            stbi_image_free(stbi_load(filename.c_str(), &w, &h, &bpp, 3));
+        });
+        report("decode", std::to_string(sizes[si]) + "x" + std::to_string(sizes[si]) + " png",
+               (double) sizes[si] * sizes[si] / seconds / 1e6, "Mtexel/s");
+        remove(filename.c_str());
+        free_texture(tex);
+    }
+}
+
+
+static FILE* open_json_output(const char filename[])
+{
+    // With "-" the JSON gets the original stdout; the printed results move to stderr.
+    if (strcmp(filename, "-") != 0) return fopen(filename, "w");
+    int fd = dup(STDOUT_FILENO);
+    FILE* file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (file) dup2(STDERR_FILENO, STDOUT_FILENO);
+    return file;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* names[] = {"edge", "raster", "texture", "transform", "clear", "parse", "decode"};
+    void (*kernels[])() = {bench_edge, bench_raster, bench_texture, bench_transform, bench_clear, bench_parse, bench_decode};
+    const int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+    // Run the named kernels, or all of them.
+    const char* json_filename = NULL;
+    std::vector<int> selected;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_filename = argv[++i];
+            continue;
+        }
+        int k = 0;
+        while (k < num_kernels && strcmp(argv[i], names[k]) != 0) k++;
+        if (k == num_kernels) {
+            printf("usage: %s [--json file] [edge|raster|texture|transform|clear|parse|decode]...\n", argv[0]);
+            return 1;
+        }
+        selected.push_back(k);
+    }
+    if (selected.empty()) {
+        for (int k = 0; k < num_kernels; k++) selected.push_back(k);
+    }
+    FILE* file = NULL;
+    if (json_filename) {
+        file = open_json_output(json_filename);
+        if (!file) {
+            printf("Could not write %s\n", json_filename);
+            return 1;
+        }
+    }
+    srand(1);
+    for (size_t i = 0; i < selected.size(); i++) kernels[selected[i]]();
+
+    if (file) {
+        fprintf(file, "[\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            fprintf(file, "  {\"kernel\": \"%s\", \"params\": \"%s\", \"value\": %.4f, \"unit\": \"%s\"}%s\n", results[i].kernel.c_str(),
+                    results[i].params.c_str(), results[i].value, results[i].unit, i + 1 < results.size() ? "," : "");
+        }
+        fprintf(file, "]\n");
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,341 @@
+/* Project ........ Python Game Engine
+ * Filename ....... profiler.c
+ * Description .... Scoped timing zones in per-thread rings with Chrome trace export.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "profiler.h"
+
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;                 // Nanoseconds since the first profile_now().
+    uint64_t end;
+    bool sampled;                   // Counter deltas are valid.
+    uint64_t counters[PROFILE_NUM_COUNTERS];
+};
+
+
+// Written only by its own thread; the head is published so exports can read
+// complete events without locking. Buffers outlive their threads so their events
+// can still be exported, and are handed to the next new thread once retired.
+struct ProfileBuffer {
+    std::atomic<uint64_t> head;
+    int tid;
+    bool retired;
+    char name[32];
+    ProfileEvent events[PROFILE_RING_SIZE];
+};
+
+
+static std::mutex buffers_lock;
+static std::vector<ProfileBuffer*> buffers;
+static std::atomic<bool> counters_enabled(false);
+
+
+static const char* counter_names[PROFILE_NUM_COUNTERS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+
+// Retires the thread's buffer when the thread exits. Counters are a group per
+// thread, opened on first use and read with a single read().
+struct ThreadBuffer {
+    ProfileBuffer* buffer = NULL;
+    bool counters_opened = false;
+    int group_fd = -1;
+    int fds[PROFILE_NUM_COUNTERS];
+    int slot[PROFILE_NUM_COUNTERS];         // Position in the group read, or -1.
+    int num_slots = 0;
+
+    ~ThreadBuffer()
+    {
+#ifdef __linux__
+        for (int c = 0; c < PROFILE_NUM_COUNTERS && counters_opened; c++) {
+            if (fds[c] >= 0) close(fds[c]);
+        }
+#endif
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(buffers_lock);
+        buffer->retired = true;
+    }
+};
+
+
+static thread_local ThreadBuffer local_buffer;
+
+
+static ProfileBuffer* thread_buffer()
+{
+    if (!local_buffer.buffer) {
+        std::lock_guard<std::mutex> lock(buffers_lock);
+        ProfileBuffer* buffer = NULL;
+        for (size_t b = 0; b < buffers.size() && !buffer; b++) {
+            if (buffers[b]->retired) buffer = buffers[b];
+        }
+        if (!buffer) {
+            buffer = new ProfileBuffer();
+            buffer->head.store(0, std::memory_order_relaxed);
+            buffer->tid = buffers.size() + 1;
+            buffers.push_back(buffer);
+        }
+        buffer->retired = false;
+        snprintf(buffer->name, sizeof(buffer->name), "thread %d", buffer->tid);
+        local_buffer.buffer = buffer;
+    }
+    return local_buffer.buffer;
+}
+
+
+uint64_t profile_now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+void profile_record(const char* name, uint64_t start, uint64_t end, const uint64_t* counters)
+{
+    ProfileBuffer* buffer = thread_buffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer->events[head & (PROFILE_RING_SIZE - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.sampled = counters != NULL;
+    if (counters) memcpy(event.counters, counters, sizeof(event.counters));
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+
+void profile_thread_name(const char name[])
+{
+    ProfileBuffer* buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+
+bool profile_enabled()
+{
+#ifdef PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+#ifdef __linux__
+static int open_counter(uint32_t type, uint64_t config, int group_fd)
+{
+    // User-space counts of the calling thread on any CPU; works with perf_event_paranoid <= 2.
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+
+static void open_thread_counters(ThreadBuffer* local)
+{
+    local->counters_opened = true;
+    for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+        local->fds[c] = -1;
+        local->slot[c] = -1;
+    }
+#ifdef __linux__
+    static const uint32_t types[PROFILE_NUM_COUNTERS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+    };
+    static const uint64_t configs[PROFILE_NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // Cycles lead the group; members the PMU lacks are left out individually.
+    local->fds[0] = open_counter(types[0], configs[0], -1);
+    if (local->fds[0] < 0) return;
+    local->group_fd = local->fds[0];
+    local->slot[0] = local->num_slots++;
+    for (int c = 1; c < PROFILE_NUM_COUNTERS; c++) {
+        local->fds[c] = open_counter(types[c], configs[c], local->group_fd);
+        if (local->fds[c] >= 0) local->slot[c] = local->num_slots++;
+    }
+    ioctl(local->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(local->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+
+bool profile_enable_counters()
+{
+    // Reports whether the calling thread got counters; others try on their first zone.
+    counters_enabled.store(true, std::memory_order_relaxed);
+    uint64_t values[PROFILE_NUM_COUNTERS];
+    if (profile_read_counters(values)) return true;
+    fprintf(stderr, "Hardware counters unavailable (see /proc/sys/kernel/perf_event_paranoid); timing only\n");
+    counters_enabled.store(false, std::memory_order_relaxed);
+    return false;
+}
+
+
+bool profile_counters_active()
+{
+    return counters_enabled.load(std::memory_order_relaxed);
+}
+
+
+bool profile_read_counters(uint64_t values[PROFILE_NUM_COUNTERS])
+{
+    if (!local_buffer.counters_opened) open_thread_counters(&local_buffer);
+    if (local_buffer.group_fd < 0) return false;
+#ifdef __linux__
+    uint64_t data[1 + PROFILE_NUM_COUNTERS];
+    if (read(local_buffer.group_fd, data, sizeof(data)) < (ssize_t) ((1 + local_buffer.num_slots) * sizeof(uint64_t))) return false;
+    for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+        values[c] = local_buffer.slot[c] < 0 ? PROFILE_COUNTER_UNAVAILABLE : data[1 + local_buffer.slot[c]];
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+const char* profile_counter_name(int counter)
+{
+    return counter_names[counter];
+}
+
+
+static void snapshot_events(ProfileBuffer* buffer, std::vector<ProfileEvent>* events)
+{
+    // Events still being overwritten by a running thread may be torn; export when idle.
+    uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t count = std::min(head, (uint64_t) PROFILE_RING_SIZE);
+    for (uint64_t k = head - count; k < head; k++) events->push_back(buffer->events[k & (PROFILE_RING_SIZE - 1)]);
+}
+
+
+int write_chrome_trace(const char filename[])
+{
+    FILE* file = fopen(filename, "w");
+    if (!file) return -1;
+
+    // Complete ("X") events in microseconds, one track per thread; loads in
+    // chrome://tracing and Perfetto.
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    for (size_t b = 0; b < buffers.size(); b++) {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                first ? "" : ",\n", buffers[b]->tid, buffers[b]->name);
+        first = false;
+        std::vector<ProfileEvent> events;
+        snapshot_events(buffers[b], &events);
+        for (size_t i = 0; i < events.size(); i++) {
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    events[i].name, buffers[b]->tid, events[i].start / 1000.0, (events[i].end - events[i].start) / 1000.0);
+            if (events[i].sampled) {
+                // Counters appear as event arguments.
+                fprintf(file, ", \"args\": {");
+                bool first_arg = true;
+                for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+                    if (events[i].counters[c] == PROFILE_COUNTER_UNAVAILABLE) continue;
+                    fprintf(file, "%s\"%s\": %llu", first_arg ? "" : ", ", counter_names[c], (unsigned long long) events[i].counters[c]);
+                    first_arg = false;
+                }
+                fprintf(file, "}");
+            }
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+
+struct ZoneTotal {
+    const char* name;
+    unsigned long count;
+    uint64_t total;
+    unsigned long sampled;
+    uint64_t counters[PROFILE_NUM_COUNTERS];
+    bool available[PROFILE_NUM_COUNTERS];
+};
+
+
+void print_profile_report(FILE* file)
+{
+    // Totals over the events still held in the rings, by zone name.
+    std::vector<ZoneTotal> totals;
+    std::lock_guard<std::mutex> lock(buffers_lock);
+    for (size_t b = 0; b < buffers.size(); b++) {
+        std::vector<ProfileEvent> events;
+        snapshot_events(buffers[b], &events);
+        for (size_t i = 0; i < events.size(); i++) {
+            size_t z = 0;
+            while (z < totals.size() && strcmp(totals[z].name, events[i].name) != 0) z++;
+            if (z == totals.size()) totals.push_back(ZoneTotal());
+            ZoneTotal& total = totals[z];
+            total.name = events[i].name;
+            total.count++;
+            total.total += events[i].end - events[i].start;
+            if (!events[i].sampled) continue;
+            total.sampled++;
+            for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+                if (events[i].counters[c] == PROFILE_COUNTER_UNAVAILABLE) continue;
+                total.counters[c] += events[i].counters[c];
+                total.available[c] = true;
+            }
+        }
+    }
+    bool any_sampled = false;
+    for (size_t z = 0; z < totals.size(); z++) any_sampled |= totals[z].sampled > 0;
+    std::sort(totals.begin(), totals.end(), [](const ZoneTotal& a, const ZoneTotal& b) { return a.total > b.total; });
+    fprintf(file, "%-16s %10s %12s %12s", "zone", "calls", "total ms", "mean us");
+    if (any_sampled) fprintf(file, " %12s %12s %6s %10s %10s %10s", "cycles", "instr", "IPC", "L1D miss", "LLC miss", "br miss");
+    fprintf(file, "\n");
+    for (size_t z = 0; z < totals.size(); z++) {
+        const ZoneTotal& total = totals[z];
+        fprintf(file, "%-16s %10lu %12.3f %12.3f", total.name, total.count, total.total / 1e6, total.total / 1e3 / total.count);
+        if (total.sampled) {
+            // Means per sampled call; "-" where the PMU has no such counter.
+            for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+                int width = c < 2 ? 12 : 10;
+                if (c == 2) {
+                    if (total.available[PROFILE_CYCLES] && total.available[PROFILE_INSTRUCTIONS] && total.counters[PROFILE_CYCLES]) {
+                        fprintf(file, " %6.2f", (double) total.counters[PROFILE_INSTRUCTIONS] / total.counters[PROFILE_CYCLES]);
+                    } else {
+                        fprintf(file, " %6s", "-");
+                    }
+                }
+                if (total.available[c]) fprintf(file, " %*.0f", width, (double) total.counters[c] / total.sampled);
+                else fprintf(file, " %*s", width, "-");
+            }
+        }
+        fprintf(file, "\n");
+    }
+}
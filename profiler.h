@@ -0,0 +1,91 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+#include <stdio.h>
+#include <stdint.h>
+
+
+#define PROFILE_RING_SIZE 65536     // Events kept per thread (power of two); older ones are overwritten.
+
+// Hardware counters sampled per zone once profile_enable_counters() is called (Linux only).
+#define PROFILE_CYCLES 0
+#define PROFILE_INSTRUCTIONS 1
+#define PROFILE_L1D_MISSES 2
+#define PROFILE_LLC_MISSES 3
+#define PROFILE_BRANCH_MISSES 4
+#define PROFILE_NUM_COUNTERS 5
+#define PROFILE_COUNTER_UNAVAILABLE UINT64_MAX
+
+
+// Timing zones are compiled in with -DPROFILE; -DPROFILE=2 adds per-triangle and
+// per-packet zones, which are much more frequent and never read counters.
+// Without it they cost nothing.
+#ifdef PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileScope PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_THREAD(name) profile_thread_name(name)
+#if PROFILE >= 2
+#define PROFILE_FINE_ZONE(name) ProfileScope PROFILE_CONCAT(profile_zone_, __LINE__)(name, false)
+#else
+#define PROFILE_FINE_ZONE(name) ((void) 0)
+#endif
+#else
+#define PROFILE_ZONE(name) ((void) 0)
+#define PROFILE_FINE_ZONE(name) ((void) 0)
+#define PROFILE_THREAD(name) ((void) 0)
+#endif
+
+
+uint64_t profile_now();
+
+void profile_record(const char* name, uint64_t start, uint64_t end, const uint64_t* counters);
+
+void profile_thread_name(const char name[]);
+
+bool profile_enabled();
+
+bool profile_enable_counters();
+
+bool profile_counters_active();
+
+bool profile_read_counters(uint64_t values[PROFILE_NUM_COUNTERS]);
+
+const char* profile_counter_name(int counter);
+
+int write_chrome_trace(const char filename[]);
+
+void print_profile_report(FILE* file);
+
+
+// Records the lifetime of a scope under a static name, with counter deltas
+// when counters are enabled. A counter read is a system call (about a
+// microsecond), so only coarse zones take them.
+struct ProfileScope {
+    const char* name;
+    uint64_t start;
+    bool sampled;
+    uint64_t counters[PROFILE_NUM_COUNTERS];
+
+    ProfileScope(const char* name, bool sample = true) : name(name)
+    {
+        sampled = sample && profile_counters_active() && profile_read_counters(counters);
+        start = profile_now();
+    }
+
+    ~ProfileScope()
+    {
+        uint64_t end = profile_now();
+        uint64_t now[PROFILE_NUM_COUNTERS];
+        if (sampled && profile_read_counters(now)) {
+            for (int c = 0; c < PROFILE_NUM_COUNTERS; c++) {
+                if (counters[c] != PROFILE_COUNTER_UNAVAILABLE) counters[c] = now[c] - counters[c];
+            }
+        } else {
+            sampled = false;
+        }
+        profile_record(name, start, end, sampled ? counters : NULL);
+    }
+};
+
+
+#endif
@@ -0,0 +1,255 @@
+/* Project ........ Python Game Engine
+ * Filename ....... quantize.c
+ * Description .... Quantized vertex storage and the fused decode/transform vertex stage.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <Eigen/Dense>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "types.h"
+#include "imports.h"
+#include "meshfile.h"
+#include "quantize.h"
+#include "jobs.h"
+
+
+uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // NaN/Inf and overflow saturate to infinity.
+    if (((bits >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 31) return sign | 0x7c00;
+
+    // Subnormal halfs (or zero) for small magnitudes.
+    if (exponent <= 0) {
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return sign | half;
+    }
+
+    // Round to nearest even; a mantissa carry correctly bumps the exponent.
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return half;
+}
+
+
+float half_to_float(uint16_t value)
+{
+    uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Renormalize subnormal halfs.
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+
+uint16_t encode_octahedral(float x, float y, float z)
+{
+    // Project onto the octahedron and fold the lower hemisphere over.
+    float l1 = fabsf(x) + fabsf(y) + fabsf(z);
+    if (l1 == 0) return 0x8080;
+    x /= l1;
+    y /= l1;
+    if (z < 0) {
+        float ox = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+        float oy = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+        x = ox;
+        y = oy;
+    }
+    int qx = (int) lrintf((x * 0.5f + 0.5f) * 255);
+    int qy = (int) lrintf((y * 0.5f + 0.5f) * 255);
+    return (uint16_t) (qx | qy << 8);
+}
+
+
+// Multiply-add fused exactly where the vector path fuses, so the scalar path
+// rounds identically and cannot be contracted differently by the compiler.
+static inline float madd(float a, float b, float c)
+{
+#ifdef __FMA__
+    return fmaf(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+
+static inline void decode_octahedral(uint16_t n, float* x, float* y, float* z)
+{
+    *x = madd(n & 0xff, 2.0f / 255, -1);
+    *y = madd(n >> 8, 2.0f / 255, -1);
+    *z = 1 - fabsf(*x) - fabsf(*y);
+    float t = std::max(-*z, 0.0f);
+    *x += *x >= 0 ? -t : t;
+    *y += *y >= 0 ? -t : t;
+}
+
+
+Mesh* quantize_mesh(Mesh* mesh)
+{
+    unsigned long n = mesh->num_vertices;
+    Mesh* packed = create_mesh(n, mesh->num_faces, MESH_QUANTIZE);
+    MeshFileHeader* header = (MeshFileHeader*) packed->storage;
+
+    // Positions become 16-bit fractions of the bounding box.
+    compute_mesh_bounds(mesh);
+    MeshFileHeader* source = (MeshFileHeader*) mesh->storage;
+    for (int k = 0; k < 3; k++) {
+        header->bounds_min[k] = source->bounds_min[k];
+        header->bounds_max[k] = source->bounds_max[k];
+        float extent = source->bounds_max[k] - source->bounds_min[k];
+        float inv_extent = extent > 0 ? 65535 / extent : 0;
+        packed->qscale[k] = extent / 65535;
+        packed->qoffset[k] = source->bounds_min[k];
+        for (unsigned long i = 0; i < n; i++) {
+            float q = ((*mesh->v)(k, i) - source->bounds_min[k]) * inv_extent;
+            packed->qv[k * n + i] = (uint16_t) std::min(std::max(lrintf(q), 0L), 65535L);
+        }
+    }
+
+    // Normals octahedral-encoded in 2x8 bits, texture coordinates as halfs.
+    for (unsigned long i = 0; i < n; i++) {
+        packed->qvn[i] = encode_octahedral((*mesh->vn)(0, i), (*mesh->vn)(1, i), (*mesh->vn)(2, i));
+        packed->qvt[2 * i] = float_to_half((*mesh->vt)(0, i));
+        packed->qvt[2 * i + 1] = float_to_half((*mesh->vt)(1, i));
+    }
+    std::copy(mesh->f, mesh->f + mesh->num_faces, packed->f);
+    return packed;
+}
+
+
+static void decode_transform_range(Mesh* mesh, const Eigen::Matrix4f& P, const Eigen::Matrix4f& N, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::MatrixXf* vt, unsigned long first, unsigned long last, bool scalar)
+{
+    unsigned long n = mesh->num_vertices;
+    const uint16_t* qx = mesh->qv;
+    const uint16_t* qy = mesh->qv + n;
+    const uint16_t* qz = mesh->qv + 2 * n;
+
+    unsigned long i = first;
+#if defined(__AVX2__) && defined(__F16C__)
+    alignas(32) float out[6][8];
+    for (; i + 8 <= last && !scalar; i += 8) {
+        // Widen 8 quantized positions and transform them in one go.
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (qx + i))));
+        __m256 y = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (qy + i))));
+        __m256 z = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (qz + i))));
+        __m256 row[4];
+        for (int r = 0; r < 4; r++) {
+            row[r] = _mm256_fmadd_ps(_mm256_set1_ps(P(r, 0)), x,
+                     _mm256_fmadd_ps(_mm256_set1_ps(P(r, 1)), y,
+                     _mm256_fmadd_ps(_mm256_set1_ps(P(r, 2)), z, _mm256_set1_ps(P(r, 3)))));
+        }
+        __m256 inv_w = _mm256_div_ps(_mm256_set1_ps(1), row[3]);
+        for (int r = 0; r < 3; r++) _mm256_store_ps(out[r], _mm256_mul_ps(row[r], inv_w));
+
+        // Octahedral normal decode, then the normal transform.
+        __m256i oct = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (mesh->qvn + i)));
+        __m256 scale = _mm256_set1_ps(2.0f / 255);
+        __m256 one = _mm256_set1_ps(1);
+        __m256 sign_bit = _mm256_set1_ps(-0.0f);
+        __m256 nx = _mm256_fmsub_ps(_mm256_cvtepi32_ps(_mm256_and_si256(oct, _mm256_set1_epi32(0xff))), scale, one);
+        __m256 ny = _mm256_fmsub_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(oct, 8)), scale, one);
+        __m256 nz = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_andnot_ps(sign_bit, nx)), _mm256_andnot_ps(sign_bit, ny));
+        __m256 t = _mm256_max_ps(_mm256_sub_ps(_mm256_setzero_ps(), nz), _mm256_setzero_ps());
+        __m256 zero = _mm256_setzero_ps();
+        nx = _mm256_add_ps(nx, _mm256_blendv_ps(t, _mm256_xor_ps(t, sign_bit), _mm256_cmp_ps(nx, zero, _CMP_GE_OQ)));
+        ny = _mm256_add_ps(ny, _mm256_blendv_ps(t, _mm256_xor_ps(t, sign_bit), _mm256_cmp_ps(ny, zero, _CMP_GE_OQ)));
+        for (int r = 0; r < 4; r++) {
+            row[r] = _mm256_fmadd_ps(_mm256_set1_ps(N(r, 0)), nx,
+                     _mm256_fmadd_ps(_mm256_set1_ps(N(r, 1)), ny,
+                     _mm256_mul_ps(_mm256_set1_ps(N(r, 2)), nz)));
+        }
+        inv_w = _mm256_div_ps(one, row[3]);
+        for (int r = 0; r < 3; r++) _mm256_store_ps(out[3 + r], _mm256_mul_ps(row[r], inv_w));
+
+        // Half texture coordinates are already laid out like the 2 x n output.
+        _mm256_storeu_ps(vt->data() + 2 * i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (mesh->qvt + 2 * i))));
+        _mm256_storeu_ps(vt->data() + 2 * i + 8, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (mesh->qvt + 2 * i + 8))));
+
+        for (int j = 0; j < 8; j++) {
+            (*v)(0, i + j) = out[0][j];
+            (*v)(1, i + j) = out[1][j];
+            (*v)(2, i + j) = out[2][j];
+            (*vn)(0, i + j) = out[3][j];
+            (*vn)(1, i + j) = out[4][j];
+            (*vn)(2, i + j) = out[5][j];
+        }
+    }
+#endif
+
+    // Scalar path for the remaining vertices, with the same operations per lane
+    // as above so both give bit-identical results.
+    for (; i < last; i++) {
+        float row[4];
+        for (int r = 0; r < 4; r++) row[r] = madd(P(r, 0), qx[i], madd(P(r, 1), qy[i], madd(P(r, 2), qz[i], P(r, 3))));
+        float inv_w = 1 / row[3];
+        for (int r = 0; r < 3; r++) (*v)(r, i) = row[r] * inv_w;
+        float x, y, z;
+        decode_octahedral(mesh->qvn[i], &x, &y, &z);
+        for (int r = 0; r < 4; r++) row[r] = madd(N(r, 0), x, madd(N(r, 1), y, N(r, 2) * z));
+        inv_w = 1 / row[3];
+        for (int r = 0; r < 3; r++) (*vn)(r, i) = row[r] * inv_w;
+        (*vt)(0, i) = half_to_float(mesh->qvt[2 * i]);
+        (*vt)(1, i) = half_to_float(mesh->qvt[2 * i + 1]);
+    }
+}
+
+
+void decode_transform_vertices(Mesh* mesh, const Eigen::Matrix4f* M, const Eigen::Matrix4f* M_inv_T, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::MatrixXf* vt, bool scalar)
+{
+    unsigned long n = mesh->num_vertices;
+    v->resize(3, n);
+    vn->resize(3, n);
+    vt->resize(2, n);
+
+    // Fold dequantization (scale and offset) into the position transform.
+    Eigen::Matrix4f D = Eigen::Matrix4f::Identity();
+    for (int k = 0; k < 3; k++) {
+        D(k, k) = mesh->qscale[k];
+        D(k, 3) = mesh->qoffset[k];
+    }
+    Eigen::Matrix4f P = (*M) * D;
+    Eigen::Matrix4f N = *M_inv_T;
+
+    // Batches are independent; the scalar reference runs on the calling thread.
+    parallel_for(default_job_system(), 0, n, scalar ? n : VERTEX_BATCH, [&](size_t first, size_t last) {
+        decode_transform_range(mesh, P, N, v, vn, vt, first, last, scalar);
+    });
+}
@@ -0,0 +1,22 @@
+#ifndef _QUANTIZE_H_
+#define _QUANTIZE_H_
+#include <stdint.h>
+#include <Eigen/Dense>
+#include "types.h"
+
+
+#define VERTEX_BATCH 4096           // Vertices transformed per job.
+
+
+uint16_t float_to_half(float value);
+
+float half_to_float(uint16_t value);
+
+uint16_t encode_octahedral(float x, float y, float z);
+
+Mesh* quantize_mesh(Mesh* mesh);
+
+void decode_transform_vertices(Mesh* mesh, const Eigen::Matrix4f* M, const Eigen::Matrix4f* M_inv_T, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::MatrixXf* vt, bool scalar = false);
+
+
+#endif
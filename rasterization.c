@@ -12,10 +12,24 @@
 #include <Eigen/Dense>
 #include <Eigen/Core>
 #include "types.h"
+#include "camera.h"
+#include "rasterization.h"
 #include "shading.h"
+#include "vtexture.h"
+#include "quantize.h"
+#include "profiler.h"
+#include "jobs.h"
 using namespace std;
 
 
+// Counters in Camera::stats, compiled in with -DRASTER_STATS.
+#ifdef RASTER_STATS
+#define RASTER_STAT(counter, n) (counter) += (n)
+#else
+#define RASTER_STAT(counter, n) ((void) 0)
+#endif
+
+
 int is_backface(Eigen::Vector3f normal) {
     return normal(2) < 0;
 }
@@ -26,32 +40,52 @@ double f(Eigen::Vector3f v0, Eigen::Vector3f v1, double x, double y) {
 }
 
 
-void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::MatrixXf* vt, Tri tri, Texture* texture) 
+void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::Map<Eigen::MatrixXf>* vt, Tri tri, Texture* texture, const ScreenRect* clip) 
 {   
     // Compute normal vector for triangle.
-    Eigen::Vector3f vn0 = vn->col(tri.ivn0).head<3>();
-    Eigen::Vector3f vn1 = vn->col(tri.ivn1).head<3>();
-    Eigen::Vector3f vn2 = vn->col(tri.ivn2).head<3>();
+    Eigen::Vector3f vn0 = vn->col(tri.i0).head<3>();
+    Eigen::Vector3f vn1 = vn->col(tri.i1).head<3>();
+    Eigen::Vector3f vn2 = vn->col(tri.i2).head<3>();
     Eigen::Vector3f normal = (vn0 + vn1 + vn2).normalized();
     
     // Backface culling
-    if (is_backface(normal)) return;
+    PROFILE_FINE_ZONE("triangle");
+    if (is_backface(normal)) {
+        RASTER_STAT(cam->stats.backfacing, 1);
+        return;
+    }
 
     // Unpack vertex coordinates.
-    Eigen::Vector3f v0 = v->col(tri.iv0).head<3>();
-    Eigen::Vector3f v1 = v->col(tri.iv1).head<3>();
-    Eigen::Vector3f v2 = v->col(tri.iv2).head<3>();
+    Eigen::Vector3f v0 = v->col(tri.i0).head<3>();
+    Eigen::Vector3f v1 = v->col(tri.i1).head<3>();
+    Eigen::Vector3f v2 = v->col(tri.i2).head<3>();
     
     // Unpack texture coordinates.
-    Eigen::Vector2f vt0 = vt->col(tri.ivt0);
-    Eigen::Vector2f vt1 = vt->col(tri.ivt1);
-    Eigen::Vector2f vt2 = vt->col(tri.ivt2);
+    Eigen::Vector2f vt0 = vt->col(tri.i0);
+    Eigen::Vector2f vt1 = vt->col(tri.i1);
+    Eigen::Vector2f vt2 = vt->col(tri.i2);
      
-    // Determine bounding box for triangle.
-    int x_min = floor(min(v0(0), min(v1(0), v2(0))));
-    int y_min = floor(min(v0(1), min(v1(1), v2(1))));
-    int x_max = ceil(max(v0(0), max(v1(0), v2(0))));
-    int y_max = ceil(max(v0(1), max(v1(1), v2(1))));
+    // Determine bounding box for triangle, clamped to the frame (in float, so far-off
+    // vertices cannot overflow the conversion).
+    int frame_width = cam->frame_width;
+    int frame_height = cam->frame_height;
+    int x_min = max(floorf(min(v0(0), min(v1(0), v2(0)))), 0.0f);
+    int y_min = max(floorf(min(v0(1), min(v1(1), v2(1)))), 0.0f);
+    int x_max = min(ceilf(max(v0(0), max(v1(0), v2(0)))), (float) (frame_width - 1));
+    int y_max = min(ceilf(max(v0(1), max(v1(1), v2(1)))), (float) (frame_height - 1));
+    if (x_min > x_max || y_min > y_max) {
+        RASTER_STAT(cam->stats.clipped, 1);
+        return;
+    }
+    
+    // Binned rasterization only touches pixels of its own bin.
+    if (clip) {
+        x_min = max(x_min, clip->x_min);
+        y_min = max(y_min, clip->y_min);
+        x_max = min(x_max, clip->x_max);
+        y_max = min(y_max, clip->y_max);
+        if (x_min > x_max || y_min > y_max) return;
+    }
     
     // Pre-compute f values.
     double fa = 1 / f(v1, v2, v0(0), v0(1));
@@ -63,21 +97,39 @@ void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* v
     double fb_off = f(v2, v0, -1, -1) / fb > 0;
     double fg_off = f(v0, v1, -1, -1) / fg > 0;
     
-    // Update alpha and beta incrementally.
-    double alpha_init = f(v1, v2, x_min, y_min) * fa;
-    double beta_init = f(v2, v0, x_min, y_min) * fb;
+    // Alpha and beta are linear in x and y. They are evaluated from the frame
+    // origin rather than stepped from the bounding box, so a pixel gets the same
+    // values whichever bin (and clipped box) it is rasterized in.
     double alpha_x_update = (v1(1) - v2(1)) * fa;
-    double alpha_y_update = (v2(0) - v1(0)) * fa; 
     double beta_x_update = (v2(1) - v0(1)) * fb;
-    double beta_y_update = (v0(0) - v2(0)) * fb;
+    double alpha_row, beta_row;
+    
+    // Select mip level for paged textures from texel to pixel footprint.
+    // Objects without a texture only write depth.
+    bool paged = texture && texture->virt;
+    int mip = 0;
+    if (paged) {
+        double uv_area = fabs((vt1(0) - vt0(0)) * (vt2(1) - vt0(1)) - (vt2(0) - vt0(0)) * (vt1(1) - vt0(1)));
+        double pixel_area = fabs((v1(0) - v0(0)) * (v2(1) - v0(1)) - (v2(0) - v0(0)) * (v1(1) - v0(1)));
+        mip = vt_select_mip(texture->virt, uv_area, pixel_area);
+    }
+    
+    // Clear stale tiles under the triangle's bounding box before touching them.
+    int tiles_x = cam->tiles_x;
+    for (int ty = (frame_height - 1 - y_max) / TILE_SIZE; ty <= (frame_height - 1 - y_min) / TILE_SIZE; ty++) {
+        for (int tx = x_min / TILE_SIZE; tx <= x_max / TILE_SIZE; tx++) {
+            if (cam->tile_epoch[ty * tiles_x + tx] != cam->epoch) clear_tile(cam, tx, ty);
+        }
+    }
     
     // Frequently accessed variables.
-    int frame_width = cam->frame_width;
-    int frame_height = cam->frame_height;
-    unsigned char* frame_buffer = cam->frame_buffer;
-    double* depth_buffer = cam->depth_buffer;
-    uint8_t* texture_data = texture->data;
-    double min_draw_dist = cam->min_draw_dist;
+    uint32_t* color_buffer = cam->color_buffer;
+    float* depth_buffer = cam->depth_buffer;
+#ifdef RASTER_STATS
+    uint16_t* overdraw_buffer = cam->overdraw_buffer;
+    unsigned long covered_before = cam->stats.pixels_covered;
+    cam->stats.pixels_tested += (unsigned long) (x_max - x_min + 1) * (y_max - y_min + 1);
+#endif
     
     signed int y, x;
     unsigned int i, j;
@@ -85,29 +137,47 @@ void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* v
     Eigen::Vector3f vertex, pixel;
     Eigen::Vector2f texcoord;
     
+    // Barycentrics of covered pixels, gathered into packets for shading.
+    alignas(32) float packet_alpha[PACKET_SIZE];
+    alignas(32) float packet_beta[PACKET_SIZE];
+    alignas(32) float packet_gamma[PACKET_SIZE];
+    unsigned int packet_mask;
+    int row, row_base;
+    
+    PROFILE_FINE_ZONE("scan");
     for (y = y_min; y <= y_max; y++) {
     
-        // Update barycentric coordinates.
-        alpha = alpha_init;
-      	beta = beta_init;
-      	gamma = 1 - (alpha + beta);
+        // Barycentric coordinates at the start of the row.
+        alpha_row = f(v1, v2, 0, y) * fa;
+        beta_row = f(v2, v0, 0, y) * fb;
+      	
+      	// Offset of this pixel row within its row of tiles.
+      	row = frame_height - 1 - y;
+      	row_base = tile_offset(tiles_x, 0, row);
+      	packet_mask = 0;
       	
         for (x = x_min; x <= x_max; x++) {
-        
-            // Boundary test: Check whether (y, x) lies withing frame bounds.
-            if (x > -1 && y > -1 && x < frame_width && y < frame_height) {
+            alpha = alpha_row + x * alpha_x_update;
+            beta = beta_row + x * beta_x_update;
+            gamma = 1 - (alpha + beta);
                
-                // Triangle test: Check whether (y, x) is included in triangle.
-                if (alpha >= 0 && beta >= 0 && gamma >= 0) {
-                    if ((alpha > 0 || fa_off) && (beta > 0 || fb_off) && (gamma > 0 || fg_off)) {        
-                               
-                        // Interpolate vertex position.
-                        vertex = alpha * v0 + beta * v1 + gamma * v2;
-                     
-                        // Depth test.
-                        i = frame_width * (frame_height - y) + x; 
-                        if (vertex(2) > depth_buffer[i] && vertex(2) < 0) {
-                        
+            // Triangle test: Check whether (y, x) is included in triangle.
+            if (alpha >= 0 && beta >= 0 && gamma >= 0) {
+                if ((alpha > 0 || fa_off) && (beta > 0 || fb_off) && (gamma > 0 || fg_off)) {        
+                           
+                    // Interpolate vertex position.
+                    vertex = alpha * v0 + beta * v1 + gamma * v2;
+                 
+                    // Depth test.
+                    i = row_base + (x / TILE_SIZE) * TILE_PIXELS + x % TILE_SIZE;
+                    RASTER_STAT(cam->stats.pixels_covered, 1);
+#ifdef RASTER_STATS
+                    if (overdraw_buffer && overdraw_buffer[i] < UINT16_MAX) overdraw_buffer[i]++;
+#endif
+                    if (vertex(2) > depth_buffer[i] && vertex(2) < 0) {
+                        RASTER_STAT(cam->stats.pixels_shaded, 1);
+                    
+                        if (paged) {
                             // Interpolate texture coordinate.
                             texcoord = alpha * vt0 + beta * vt1 + gamma * vt2;
                             
@@ -115,53 +185,162 @@ void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* v
                             normal = alpha * vn0 + beta * vn1 + gamma * vn2;
                             
                             // Fill in pixel with correct color.
-                            shade_pixel(&pixel, &vertex, &normal, &texcoord, texture);
-                            frame_buffer[3 * i] = pixel(0);
-                            frame_buffer[3 * i + 1] = pixel(1);
-                            frame_buffer[3 * i + 2] = pixel(2);
-                            
-                            // Update depth buffer.
-                            depth_buffer[i] = vertex(2);
+                            shade_pixel(&pixel, &vertex, &normal, &texcoord, texture, mip);
+                            color_buffer[i] = pack_rgba(pixel(0), pixel(1), pixel(2));
+                        } else if (texture) {
+                            // Defer shading to the packet.
+                            j = x % TILE_SIZE;
+                            packet_alpha[j] = alpha;
+                            packet_beta[j] = beta;
+                            packet_gamma[j] = gamma;
+                            packet_mask |= 1 << j;
                         }
+                        
+                        // Update depth buffer.
+                        depth_buffer[i] = vertex(2);
+                    } else {
+                        RASTER_STAT(cam->stats.pixels_occluded, 1);
                     }
                 }
             }
-            // Update barycentric coords.
-            alpha += alpha_x_update;
-            beta += beta_x_update;
-            gamma = 1 - (alpha + beta);
+            
+            // Shade the packet at the end of each tile row or when the row ends.
+            if (x % TILE_SIZE == TILE_SIZE - 1 || x == x_max) {
+                if (packet_mask) {
+                    uint32_t* dst = color_buffer + row_base + (x / TILE_SIZE) * TILE_PIXELS;
+                    if (cam->reference) shade_packet_scalar(dst, packet_mask, packet_alpha, packet_beta, packet_gamma, &vt0, &vt1, &vt2, texture);
+                    else shade_packet(dst, packet_mask, packet_alpha, packet_beta, packet_gamma, &vt0, &vt1, &vt2, texture);
+                }
+                packet_mask = 0;
+            }
         }
-        alpha_init += alpha_y_update;
-  	    beta_init += beta_y_update;   
     }
+#ifdef RASTER_STATS
+    if (cam->stats.pixels_covered == covered_before) cam->stats.empty++;
+#endif
     return; 
 }
 
 
+static bool triangle_bounds(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Tri tri, ScreenRect* box)
+{
+    // Same culling and bounding box as rasterize_mesh_triangle, for binning.
+    Eigen::Vector3f normal = (vn->col(tri.i0).head<3>() + vn->col(tri.i1).head<3>() + vn->col(tri.i2).head<3>()).normalized();
+    if (is_backface(normal)) return false;
+    Eigen::Vector3f v0 = v->col(tri.i0).head<3>();
+    Eigen::Vector3f v1 = v->col(tri.i1).head<3>();
+    Eigen::Vector3f v2 = v->col(tri.i2).head<3>();
+    box->x_min = max(floorf(min(v0(0), min(v1(0), v2(0)))), 0.0f);
+    box->y_min = max(floorf(min(v0(1), min(v1(1), v2(1)))), 0.0f);
+    box->x_max = min(ceilf(max(v0(0), max(v1(0), v2(0)))), (float) (cam->frame_width - 1));
+    box->y_max = min(ceilf(max(v0(1), max(v1(1), v2(1)))), (float) (cam->frame_height - 1));
+    return box->x_min <= box->x_max && box->y_min <= box->y_max;
+}
+
+
+static void rasterize_binned(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::Map<Eigen::MatrixXf>* vt, Tri* faces, unsigned long num_faces, Texture* texture, JobSystem* jobs)
+{
+    // Screen bins are whole tiles, counted from the top like tile rows, so each
+    // tile (and its lazy clear) belongs to exactly one bin.
+    int frame_width = cam->frame_width;
+    int frame_height = cam->frame_height;
+    int bins_x = (frame_width + RASTER_BIN_SIZE - 1) / RASTER_BIN_SIZE;
+    int bins_y = (frame_height + RASTER_BIN_SIZE - 1) / RASTER_BIN_SIZE;
+    int num_bins = bins_x * bins_y;
+    
+    // Bin triangles in batches. Each batch keeps its own lists, and bins walk the
+    // batches in order, so every pixel sees its triangles in submission order.
+    size_t num_batches = (num_faces + RASTER_BIN_BATCH - 1) / RASTER_BIN_BATCH;
+    std::vector<std::vector<unsigned int> > lists(num_batches * num_bins);
+    parallel_for(jobs, 0, num_batches, 1, [&](size_t first, size_t last) {
+        for (size_t b = first; b < last; b++) {
+            std::vector<unsigned int>* batch = &lists[b * num_bins];
+            unsigned long end = min((unsigned long) (b + 1) * RASTER_BIN_BATCH, num_faces);
+            for (unsigned long t = b * RASTER_BIN_BATCH; t < end; t++) {
+                ScreenRect box;
+                if (!triangle_bounds(cam, v, vn, faces[t], &box)) continue;
+                for (int by = (frame_height - 1 - box.y_max) / RASTER_BIN_SIZE; by <= (frame_height - 1 - box.y_min) / RASTER_BIN_SIZE; by++) {
+                    for (int bx = box.x_min / RASTER_BIN_SIZE; bx <= box.x_max / RASTER_BIN_SIZE; bx++) {
+                        batch[by * bins_x + bx].push_back(t);
+                    }
+                }
+            }
+        }
+    });
+    
+    parallel_for(jobs, 0, num_bins, 1, [&](size_t first, size_t last) {
+        for (size_t bin = first; bin < last; bin++) {
+            int bx = bin % bins_x, by = bin / bins_x;
+            ScreenRect clip;
+            clip.x_min = bx * RASTER_BIN_SIZE;
+            clip.x_max = min(clip.x_min + RASTER_BIN_SIZE, frame_width) - 1;
+            clip.y_max = frame_height - 1 - by * RASTER_BIN_SIZE;
+            clip.y_min = max(clip.y_max - RASTER_BIN_SIZE + 1, 0);
+            for (size_t b = 0; b < num_batches; b++) {
+                const std::vector<unsigned int>& list = lists[b * num_bins + bin];
+                for (size_t k = 0; k < list.size(); k++) {
+                    rasterize_mesh_triangle(cam, v, vn, vt, faces[list[k]], texture, &clip);
+                }
+            }
+        }
+    });
+}
+
+
 void rasterize_mesh(Camera* cam, Object* obj)
 {  
     // Transform vertices in world coordinates into camera coordinates.
     Mesh* mesh = obj->mesh;
-    Eigen::MatrixXf M, v, vn;
-    M = (*cam->Mvp) * (*cam->Mcam);
-    v = (M * (*mesh->v)).colwise().hnormalized();
+    Eigen::MatrixXf v, vn, vt_decoded;
+    update_camera(cam);
     
-    // Transform normals.
-    Eigen::MatrixXf M_inv_T = M.inverse().transpose();
-    vn = (M_inv_T * (*obj->mesh->vn)).colwise().hnormalized();
+    // Objects placed in the world need their own combined transform.
+    Eigen::Matrix4f M = cam->M, M_inv_T = cam->M_inv_T;
+    if (!obj->transform.isIdentity(0)) {
+        M = cam->M * obj->transform;
+        M_inv_T = M.inverse().transpose();
+    }
+    
+    // The reference path stays on the calling thread.
+    JobSystem* jobs = default_job_system();
+    unsigned long n = mesh->num_vertices;
+    {
+        PROFILE_ZONE("transform");
+        if (mesh->qv) {
+            // Quantized meshes decode inside the vertex transform.
+            decode_transform_vertices(mesh, &M, &M_inv_T, &v, &vn, &vt_decoded, cam->reference);
+        } else {
+            v.resize(3, n);
+            vn.resize(3, n);
+            parallel_for(jobs, 0, n, cam->reference ? n : VERTEX_BATCH, [&](size_t first, size_t last) {
+                v.middleCols(first, last - first) = (M * mesh->v->middleCols(first, last - first)).colwise().hnormalized();
+            
+                // Transform normals.
+                vn.middleCols(first, last - first) = (M_inv_T * mesh->vn->middleCols(first, last - first)).colwise().hnormalized();
+            });
+        }
+    }
+    Eigen::Map<Eigen::MatrixXf> vt(mesh->qv ? vt_decoded.data() : mesh->vt->data(), 2, n);
     
     // Unpack texture
     Texture* texture = obj->texture;
 
-    vector<Tri> faces = (*mesh->f);
-    unsigned long num_faces = faces.size();    
+    PROFILE_ZONE("rasterize");
+    Tri* faces = mesh->f;
+    unsigned long num_faces = mesh->num_faces;
+    RASTER_STAT(cam->stats.triangles, num_faces);
+    
+    // Bins are rasterized in parallel. Counter builds keep to one thread so the
+    // counts stay exact, as do paged textures, whose tile feedback is unshared.
+    bool binned = !cam->reference && !(texture && texture->virt) && job_threads(jobs) > 1;
+#ifdef RASTER_STATS
+    binned = false;
+#endif
+    if (binned) {
+        rasterize_binned(cam, &v, &vn, &vt, faces, num_faces, texture, jobs);
+        return;
+    }
     for (unsigned long i = 0; i < num_faces; i++) {
-        rasterize_mesh_triangle(cam, &v, &vn, mesh->vt, faces[i], texture);
+        rasterize_mesh_triangle(cam, &v, &vn, &vt, faces[i], texture);
     }
 }
-
-
-
-
-
-
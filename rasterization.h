@@ -8,11 +8,21 @@
 using namespace std;
 
 
+#define RASTER_BIN_SIZE 64          // Screen bin edge in pixels (a multiple of TILE_SIZE).
+#define RASTER_BIN_BATCH 16384      // Triangles binned per job.
+
+
+// Inclusive pixel rectangle.
+struct ScreenRect {
+    int x_min, y_min, x_max, y_max;
+};
+
+
 int is_backface(Eigen::Vector3f normal);
 
 double f(Eigen::Vector3f v0, Eigen::Vector3f v1, double x, double y);
 
-void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::MatrixXf* vt, Tri tri, Texture* texture);
+void rasterize_mesh_triangle(Camera* cam, Eigen::MatrixXf* v, Eigen::MatrixXf* vn, Eigen::Map<Eigen::MatrixXf>* vt, Tri tri, Texture* texture, const ScreenRect* clip = NULL);
 
 void rasterize_mesh(Camera* cam, Object* obj);
 
@@ -0,0 +1,152 @@
+/* Project ........ Python Game Engine
+ * Filename ....... replay.c
+ * Description .... Headless replay of frame captures, as fast as possible, with frame timings.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -DNO_GLFW -o replay replay.c capture.c backend.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "imports.h"
+#include "camera.h"
+#include "rasterization.h"
+#include "vtexture.h"
+#include "meshfile.h"
+#include "backend.h"
+#include "capture.h"
+
+
+static double percentile(std::vector<double> values, double p)
+{
+    // Nearest-rank percentile.
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t) ceil(p / 100 * values.size());
+    return values[std::min(std::max(rank, (size_t) 1), values.size()) - 1];
+}
+
+
+static FILE* open_json_output(const char filename[])
+{
+    // JSON on stdout takes the descriptor for itself; the summary goes to stderr.
+    if (strcmp(filename, "-") != 0) return fopen(filename, "w");
+    int fd = dup(STDOUT_FILENO);
+    FILE* file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (file) dup2(STDERR_FILENO, STDOUT_FILENO);
+    return file;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const char* filename = NULL;
+    int output = OUTPUT_NONE;
+    const char* prefix = "replay";
+    const char* json_filename = NULL;
+    int repeat = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = parse_output_format(argv[++i]);
+        else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) prefix = argv[++i];
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_filename = argv[++i];
+        else if (argv[i][0] != '-' && !filename) filename = argv[i];
+        else output = -1;
+    }
+    bool json_stdout = json_filename && strcmp(json_filename, "-") == 0;
+    if (!filename || output < 0 || (json_stdout && output == OUTPUT_RAW && strcmp(prefix, "-") == 0)) {
+        printf("usage: %s [--output none|ppm|png|raw] [--prefix path] [--repeat N] [--json file] capture%s\n", argv[0], CAPTURE_EXTENSION);
+        return 1;
+    }
+    FILE* json = NULL;
+    if (json_filename) {
+        json = open_json_output(json_filename);
+        if (!json) {
+            printf("Could not write %s\n", json_filename);
+            return 1;
+        }
+    }
+    Capture* capture = load_capture(filename);
+    if (!capture) return 1;
+    if (capture->frames.empty()) {
+        printf("%s has no frames\n", filename);
+        free_capture(capture);
+        return 1;
+    }
+
+    // Output first, as raw frames sent to stdout move all other output to stderr.
+    const CaptureHeader& h = capture->header;
+    Backend* backend = create_headless_backend(h.width, h.height, output, prefix, 0);
+    if (!backend) return 1;
+
+    // Load every asset up front so frames measure rendering only.
+    std::vector<Object> assets;
+    for (size_t a = 0; a < capture->assets.size(); a++) {
+        const CaptureAsset& asset = capture->assets[a];
+        assets.push_back(load_object(asset.mesh.c_str(), asset.texture.c_str(), asset.flags));
+        if (!assets.back().mesh) {
+            printf("Could not load %s\n", asset.mesh.c_str());
+            return 1;
+        }
+        if (!assets.back().texture) printf("Drawing %s without its texture\n", asset.mesh.c_str());
+    }
+
+    Camera cam = create_camera(h.width, h.height, capture->frames[0].origin, capture->frames[0].direction,
+                               h.fov, h.min_draw_dist, h.max_draw_dist);
+
+    // Frames are written on the first pass only; repeats are for timing.
+    std::vector<double> frame_ms;
+    for (int pass = 0; pass < repeat; pass++) {
+        for (size_t k = 0; k < capture->frames.size(); k++) {
+            const CaptureFrame& frame = capture->frames[k];
+            auto start = std::chrono::high_resolution_clock::now();
+            reset_camera(&cam);
+            move_camera(&cam, frame.origin, frame.direction);
+            for (size_t d = 0; d < frame.draws.size(); d++) {
+                Object obj = assets[frame.draws[d].asset];
+                obj.transform = frame.draws[d].transform;
+                rasterize_mesh(&cam, &obj);
+                if (obj.texture && obj.texture->virt) vt_update(obj.texture->virt->cache);
+            }
+            resolve_camera(&cam);
+            auto finish = std::chrono::high_resolution_clock::now();
+            frame_ms.push_back(std::chrono::duration<double, std::milli>(finish - start).count());
+            if (pass == 0) present_frame(backend, &cam);
+        }
+    }
+
+    // Slowest frame first points at where to look.
+    double total = 0;
+    size_t slowest = 0;
+    for (size_t i = 0; i < frame_ms.size(); i++) {
+        total += frame_ms[i];
+        if (frame_ms[i] > frame_ms[slowest]) slowest = i;
+    }
+    double mean = total / frame_ms.size();
+    printf("%zu frames x %d: mean %.3f ms  p50 %.3f  p95 %.3f  p99 %.3f  slowest %.3f (frame %zu)\n",
+           capture->frames.size(), repeat, mean, percentile(frame_ms, 50), percentile(frame_ms, 95),
+           percentile(frame_ms, 99), frame_ms[slowest], slowest % capture->frames.size());
+
+    if (json) {
+        fprintf(json, "{\n  \"capture\": \"%s\",\n  \"frames\": %zu,\n  \"repeat\": %d,\n  \"mean_ms\": %.4f,\n"
+                "  \"p50_ms\": %.4f,\n  \"p95_ms\": %.4f,\n  \"p99_ms\": %.4f,\n  \"slowest_frame\": %zu,\n  \"frame_ms\": [",
+                filename, capture->frames.size(), repeat, mean, percentile(frame_ms, 50), percentile(frame_ms, 95),
+                percentile(frame_ms, 99), slowest % capture->frames.size());
+        for (size_t i = 0; i < frame_ms.size(); i++) fprintf(json, "%s%.4f", i ? ", " : "", frame_ms[i]);
+        fprintf(json, "]\n}\n");
+        fclose(json);
+    }
+
+    destroy_backend(backend);
+    destroy_camera(&cam);
+    for (size_t a = 0; a < assets.size(); a++) {
+        free_mesh(assets[a].mesh);
+        free_texture(assets[a].texture);
+    }
+    free_capture(capture);
+    return 0;
+}
@@ -8,7 +8,13 @@
 #include <vector>
 #include <iostream>
 #include <math.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 #include "types.h"
+#include "shading.h"
+#include "vtexture.h"
+#include "profiler.h"
 
  
 unsigned int texture_lookup(Texture* tex, Eigen::Vector2f* texcoord)
@@ -23,16 +29,26 @@ unsigned int texture_lookup(Texture* tex, Eigen::Vector2f* texcoord)
     // Repeat texture.
     u = u % width;
     v = v % height;
-    if (u < 0) u = width - u;
-    if (v < 0) v = width - v;
+    if (u < 0) u = width + u;
+    if (v < 0) v = height + v;
     
     // Return pixel index.
     return 3 * (v * width + u);
 }
 
 
-void shade_pixel(Eigen::Vector3f* pixel, Eigen::Vector3f* vertex, Eigen::Vector3f* normal, Eigen::Vector2f* texcoord, Texture* texture)
+void shade_pixel(Eigen::Vector3f* pixel, Eigen::Vector3f* vertex, Eigen::Vector3f* normal, Eigen::Vector2f* texcoord, Texture* texture, int mip)
 {
+    // Paged textures sample through the tile cache at the triangle's mip.
+    if (texture->virt) {
+        uint8_t rgb[3];
+        vt_sample(texture->virt, texcoord, mip, rgb);
+        (*pixel)(0) = rgb[0];
+        (*pixel)(1) = rgb[1];
+        (*pixel)(2) = rgb[2];
+        return;
+    }
+
     // Look up pixel color from texture.
     unsigned int i = texture_lookup(texture, texcoord);
 
@@ -55,5 +71,60 @@ void shade_pixel(Eigen::Vector3f* pixel, Eigen::Vector3f* vertex, Eigen::Vector3
 }
 
 
+void shade_packet(uint32_t* dst, unsigned int mask, const float* alpha, const float* beta, const float* gamma, Eigen::Vector2f* vt0, Eigen::Vector2f* vt1, Eigen::Vector2f* vt2, Texture* texture)
+{
+    PROFILE_FINE_ZONE("shade");
+#ifdef __AVX2__
+    // Expand the coverage mask to one all-ones lane per covered pixel.
+    __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+    
+    // Interpolate texture coordinates.
+    __m256 a = _mm256_load_ps(alpha);
+    __m256 b = _mm256_load_ps(beta);
+    __m256 g = _mm256_load_ps(gamma);
+    __m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps((*vt0)(0))),
+                                           _mm256_mul_ps(b, _mm256_set1_ps((*vt1)(0)))),
+                                           _mm256_mul_ps(g, _mm256_set1_ps((*vt2)(0))));
+    __m256 t = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps((*vt0)(1))),
+                                           _mm256_mul_ps(b, _mm256_set1_ps((*vt1)(1)))),
+                                           _mm256_mul_ps(g, _mm256_set1_ps((*vt2)(1))));
+    
+    // Nearest neighbor interpolation with repeat wrapping (see texture_lookup).
+    __m256 width = _mm256_set1_ps(texture->width);
+    __m256 height = _mm256_set1_ps(texture->height);
+    __m256 half = _mm256_set1_ps(.5f);
+    __m256 u = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(width, s), half));
+    __m256 v = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(height, _mm256_sub_ps(_mm256_set1_ps(1), t)), half));
+    u = _mm256_sub_ps(u, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(u, width)), width));
+    v = _mm256_sub_ps(v, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(v, height)), height));
+    
+    // Texel byte offsets; inactive lanes are zeroed and never fetched.
+    __m256i iu = _mm256_max_epi32(_mm256_min_epi32(_mm256_cvttps_epi32(u), _mm256_set1_epi32(texture->width - 1)), _mm256_setzero_si256());
+    __m256i iv = _mm256_max_epi32(_mm256_min_epi32(_mm256_cvttps_epi32(v), _mm256_set1_epi32(texture->height - 1)), _mm256_setzero_si256());
+    __m256i index = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(iv, _mm256_set1_epi32(texture->width)), iu), _mm256_set1_epi32(3));
+    index = _mm256_and_si256(index, active);
+    
+    // Gather one RGBx dword per pixel (texture data is padded by a byte) and make it opaque.
+    __m256i texel = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*) texture->data, index, active, 1);
+    texel = _mm256_or_si256(_mm256_and_si256(texel, _mm256_set1_epi32(0x00ffffff)), _mm256_set1_epi32(0xff000000));
+    
+    // The packet is a tile row, so this is a single aligned masked store.
+    _mm256_maskstore_epi32((int*) dst, active, texel);
+#else
+    shade_packet_scalar(dst, mask, alpha, beta, gamma, vt0, vt1, vt2, texture);
+#endif
+}
 
 
+void shade_packet_scalar(uint32_t* dst, unsigned int mask, const float* alpha, const float* beta, const float* gamma, Eigen::Vector2f* vt0, Eigen::Vector2f* vt1, Eigen::Vector2f* vt2, Texture* texture)
+{
+    // Pixel by pixel through texture_lookup; the reference for shade_packet.
+    Eigen::Vector2f texcoord;
+    for (int j = 0; j < PACKET_SIZE; j++) {
+        if (!(mask & (1 << j))) continue;
+        texcoord = alpha[j] * (*vt0) + beta[j] * (*vt1) + gamma[j] * (*vt2);
+        unsigned int i = texture_lookup(texture, &texcoord);
+        dst[j] = pack_rgba(texture->data[i], texture->data[i + 1], texture->data[i + 2]);
+    }
+}
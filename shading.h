@@ -4,8 +4,23 @@
 #include <vector>
 #include "types.h"
 
-unsigned int texture_lookup(Eigen::Vector2f* texcoord);
+// Number of horizontally adjacent pixels shaded per shade_packet call;
+// a packet is one row of a frame buffer tile.
+#define PACKET_SIZE TILE_SIZE
 
-void shade_pixel(Eigen::Vector3f* pixel, Eigen::Vector3f* vertex, Eigen::Vector3f* normal, Eigen::Vector2f* texcoord, Texture* texture);
+
+// RGBA8 frame buffer pixel with opaque alpha.
+static inline uint32_t pack_rgba(unsigned int r, unsigned int g, unsigned int b)
+{
+    return r | (g << 8) | (b << 16) | 0xff000000u;
+}
+
+unsigned int texture_lookup(Texture* tex, Eigen::Vector2f* texcoord);
+
+void shade_pixel(Eigen::Vector3f* pixel, Eigen::Vector3f* vertex, Eigen::Vector3f* normal, Eigen::Vector2f* texcoord, Texture* texture, int mip);
+
+void shade_packet(uint32_t* dst, unsigned int mask, const float* alpha, const float* beta, const float* gamma, Eigen::Vector2f* vt0, Eigen::Vector2f* vt1, Eigen::Vector2f* vt2, Texture* texture);
+
+void shade_packet_scalar(uint32_t* dst, unsigned int mask, const float* alpha, const float* beta, const float* gamma, Eigen::Vector2f* vt0, Eigen::Vector2f* vt1, Eigen::Vector2f* vt2, Texture* texture);
 
 #endif
@@ -0,0 +1,99 @@
+/* Project ........ Python Game Engine
+ * Filename ....... soak.c
+ * Description .... Soak test: renders many frames and fails if resident memory keeps growing.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -o soak soak.c shading.c rasterization.c camera.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include "imports.h"
+#include "camera.h"
+#include "rasterization.h"
+#include "vtexture.h"
+#include "meshfile.h"
+
+
+// Render settings (as in main.c).
+const int FRAME_WIDTH = 640;
+const int FRAME_HEIGHT = 480;
+const float FOV = 35;
+const float MIN_DRAW_DIST = 0.01f;
+const float MAX_DRAW_DIST = 100.0f;
+
+#define SOAK_WARMUP_FRAMES 200          // Frames before the baseline is taken.
+#define SOAK_REPORT_FRAMES 10000
+
+
+static double resident_mb()
+{
+    // Second field of statm: resident pages.
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long size = 0, resident = 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(file);
+    return resident * (double) sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+
+int main(int argc, char* argv[])
+{
+    unsigned long frames = 100000;
+    double tolerance = 4;
+    const char* mesh = "models/Scene2.obj";
+    const char* texture = "textures/Scene2_baked.png";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--mesh") == 0 && i + 2 < argc) {
+            mesh = argv[++i];
+            texture = argv[++i];
+        } else {
+            printf("usage: %s [--frames N] [--tolerance MB] [--mesh mesh.obj texture]\n", argv[0]);
+            return 1;
+        }
+    }
+    Object obj = load_object(mesh, texture, MESH_OPTIMIZE_ORDER);
+    if (!obj.mesh || !obj.texture) {
+        printf("Could not load %s / %s\n", mesh, texture);
+        return 1;
+    }
+
+    // Orbit like main.c, 0.02 rad (about 1.15 degrees) per frame, so the whole
+    // frame keeps changing.
+    Eigen::Vector3f origin(5, -5, 5);
+    Eigen::Vector3f direction = -origin.normalized();
+    Camera cam = create_camera(FRAME_WIDTH, FRAME_HEIGHT, origin, direction, FOV, MIN_DRAW_DIST, MAX_DRAW_DIST);
+    Eigen::Matrix3f R = Eigen::AngleAxisf(-0.02f, Eigen::Vector3f::UnitZ()).toRotationMatrix();
+
+    // Growth is measured against the baseline after warmup, when buffers and
+    // caches have reached their working size.
+    double baseline = 0, peak = 0;
+    unsigned long warmup = std::min((unsigned long) SOAK_WARMUP_FRAMES, frames / 2);
+    for (unsigned long k = 0; k < frames; k++) {
+        reset_camera(&cam);
+        origin = R * origin;
+        move_camera(&cam, origin, -origin.normalized());
+        rasterize_mesh(&cam, &obj);
+        if (obj.texture->virt) vt_update(obj.texture->virt->cache);
+        resolve_camera(&cam);
+
+        if (k + 1 == warmup) baseline = peak = resident_mb();
+        if (k + 1 > warmup) peak = std::max(peak, resident_mb());
+        if ((k + 1) % SOAK_REPORT_FRAMES == 0) printf("frame %lu: %.2f MB resident (baseline %.2f)\n", k + 1, resident_mb(), baseline);
+    }
+    double growth = peak - baseline;
+    bool ok = growth <= tolerance;
+    printf("%s  %lu frames, resident %.2f MB after warmup, peak %.2f MB, growth %.2f MB (tolerance %.2f)\n",
+           ok ? "ok" : "FAIL", frames, baseline, peak, growth, tolerance);
+
+    destroy_camera(&cam);
+    free_mesh(obj.mesh);
+    free_texture(obj.texture);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,423 @@
+/* Project ........ Python Game Engine
+ * Filename ....... streaming.c
+ * Description .... Out-of-core streaming of spatially chunked meshes under a memory budget.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#include <Eigen/Dense>
+#include "types.h"
+#include "imports.h"
+#include "camera.h"
+#include "meshfile.h"
+#include "rasterization.h"
+#include "streaming.h"
+#include "profiler.h"
+
+
+static void partition_faces(Mesh* mesh, std::vector<unsigned int>& faces, size_t begin, size_t end, unsigned int max_chunk_faces, std::vector<std::pair<size_t, size_t> >* leaves)
+{
+    if (end - begin <= max_chunk_faces) {
+        leaves->push_back(std::make_pair(begin, end));
+        return;
+    }
+
+    // Split at the median centroid along the longest axis of the centroid bounds.
+    Eigen::Vector3f lo = Eigen::Vector3f::Constant(1e30f), hi = Eigen::Vector3f::Constant(-1e30f);
+    for (size_t i = begin; i < end; i++) {
+        Tri tri = mesh->f[faces[i]];
+        Eigen::Vector3f c = (mesh->v->col(tri.i0) + mesh->v->col(tri.i1) + mesh->v->col(tri.i2)).head<3>() / 3;
+        lo = lo.cwiseMin(c);
+        hi = hi.cwiseMax(c);
+    }
+    int axis;
+    (hi - lo).maxCoeff(&axis);
+    size_t mid = begin + (end - begin) / 2;
+    std::nth_element(faces.begin() + begin, faces.begin() + mid, faces.begin() + end, [mesh, axis](unsigned int a, unsigned int b) {
+        Tri ta = mesh->f[a], tb = mesh->f[b];
+        float ca = (*mesh->v)(axis, ta.i0) + (*mesh->v)(axis, ta.i1) + (*mesh->v)(axis, ta.i2);
+        float cb = (*mesh->v)(axis, tb.i0) + (*mesh->v)(axis, tb.i1) + (*mesh->v)(axis, tb.i2);
+        return ca < cb;
+    });
+    partition_faces(mesh, faces, begin, mid, max_chunk_faces, leaves);
+    partition_faces(mesh, faces, mid, end, max_chunk_faces, leaves);
+}
+
+
+static Mesh* extract_chunk(Mesh* mesh, const unsigned int* faces, size_t num_faces, std::vector<unsigned int>& remap)
+{
+    // Give the chunk its own compact vertex buffer.
+    std::vector<unsigned int> used;
+    for (size_t i = 0; i < num_faces; i++) {
+        const unsigned int* index = &mesh->f[faces[i]].i0;
+        for (int k = 0; k < 3; k++) {
+            if (remap[index[k]] == 0xffffffffu) {
+                remap[index[k]] = used.size();
+                used.push_back(index[k]);
+            }
+        }
+    }
+
+    Mesh* chunk = create_mesh(used.size(), num_faces);
+    for (size_t i = 0; i < used.size(); i++) {
+        chunk->v->col(i) = mesh->v->col(used[i]);
+        chunk->vt->col(i) = mesh->vt->col(used[i]);
+        chunk->vn->col(i) = mesh->vn->col(used[i]);
+    }
+    for (size_t i = 0; i < num_faces; i++) {
+        Tri tri = mesh->f[faces[i]];
+        chunk->f[i].i0 = remap[tri.i0];
+        chunk->f[i].i1 = remap[tri.i1];
+        chunk->f[i].i2 = remap[tri.i2];
+    }
+    compute_mesh_bounds(chunk);
+
+    // Reset the shared remap table for the next chunk.
+    for (size_t i = 0; i < used.size(); i++) remap[used[i]] = 0xffffffffu;
+    return chunk;
+}
+
+
+int build_streaming_mesh(const char src_filename[], const char dst_filename[], unsigned int max_chunk_faces)
+{
+    Mesh* mesh = load_mesh(src_filename, MESH_OPTIMIZE_ORDER);
+    if (!mesh) return -1;
+
+    // Partition triangles spatially into chunks of bounded size.
+    std::vector<unsigned int> faces(mesh->num_faces);
+    for (size_t i = 0; i < faces.size(); i++) faces[i] = i;
+    std::vector<std::pair<size_t, size_t> > leaves;
+    if (!faces.empty()) partition_faces(mesh, faces, 0, faces.size(), max_chunk_faces, &leaves);
+
+    StreamingMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SMESH_MAGIC, sizeof(SMESH_MAGIC));
+    header.version = SMESH_VERSION;
+    header.num_chunks = leaves.size();
+    memcpy(header.bounds_min, ((MeshFileHeader*) mesh->storage)->bounds_min, sizeof(header.bounds_min));
+    memcpy(header.bounds_max, ((MeshFileHeader*) mesh->storage)->bounds_max, sizeof(header.bounds_max));
+    header.chunk_table_offset = sizeof(header);
+
+    FILE* file = fopen(dst_filename, "wb");
+    if (!file) {
+        free_mesh(mesh);
+        return -1;
+    }
+
+    // Write chunks page-aligned after the header and chunk table.
+    std::vector<StreamingChunkInfo> table(leaves.size());
+    std::vector<unsigned int> remap(mesh->num_vertices, 0xffffffffu);
+    uint64_t table_end = header.chunk_table_offset + table.size() * sizeof(StreamingChunkInfo);
+    uint64_t offset = (table_end + SMESH_PAGE_SIZE - 1) & ~(uint64_t) (SMESH_PAGE_SIZE - 1);
+    for (size_t c = 0; c < leaves.size(); c++) {
+        Mesh* chunk = extract_chunk(mesh, &faces[leaves[c].first], leaves[c].second - leaves[c].first, remap);
+        MeshFileHeader* chunk_header = (MeshFileHeader*) chunk->storage;
+        memcpy(table[c].bounds_min, chunk_header->bounds_min, sizeof(table[c].bounds_min));
+        memcpy(table[c].bounds_max, chunk_header->bounds_max, sizeof(table[c].bounds_max));
+        table[c].offset = offset;
+        table[c].size = chunk->storage_size;
+        table[c].num_vertices = chunk->num_vertices;
+        table[c].num_faces = chunk->num_faces;
+
+        fseek(file, offset, SEEK_SET);
+        fwrite(chunk->storage, chunk->storage_size, 1, file);
+        offset = (offset + chunk->storage_size + SMESH_PAGE_SIZE - 1) & ~(uint64_t) (SMESH_PAGE_SIZE - 1);
+        free_mesh(chunk);
+    }
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    if (!table.empty()) fwrite(&table[0], sizeof(StreamingChunkInfo), table.size(), file);
+    int result = fclose(file) == 0 ? 0 : -1;
+
+    printf("Wrote %lu chunks to %s\n", (unsigned long) leaves.size(), dst_filename);
+    free_mesh(mesh);
+    return result;
+}
+
+
+static void loader_main(StreamingMesh* smesh)
+{
+    PROFILE_THREAD("chunk loader");
+    std::unique_lock<std::mutex> guard(smesh->lock);
+    while (true) {
+        smesh->wake.wait(guard, [smesh] { return smesh->stop || !smesh->requests.empty(); });
+        if (smesh->stop) return;
+        uint32_t c = smesh->requests.front();
+        smesh->requests.pop_front();
+        StreamingChunkInfo info = smesh->chunks[c].info;
+        guard.unlock();
+
+        // Read the chunk into its own buffer; it is used in place as a mesh, so
+        // its streams are checked like those of a mapped mesh file.
+        PROFILE_ZONE("load chunk");
+        void* storage = aligned_alloc(SMESH_PAGE_SIZE, (info.size + SMESH_PAGE_SIZE - 1) & ~(uint64_t) (SMESH_PAGE_SIZE - 1));
+        size_t done = 0;
+        while (storage && done < info.size) {
+            ssize_t n = pread(smesh->fd, (uint8_t*) storage + done, info.size - done, info.offset + done);
+            if (n <= 0) break;
+            done += n;
+        }
+        Mesh* mesh = NULL;
+        MeshFileHeader* header = (MeshFileHeader*) storage;
+        if (storage && done == info.size && valid_mesh_storage(storage, info.size)
+            && header->num_vertices == info.num_vertices && header->num_faces == info.num_faces) {
+            mesh = wrap_mesh_storage(storage, info.size, false);
+        } else {
+            fprintf(stderr, "Failed to read streaming mesh chunk %u\n", c);
+            free(storage);
+        }
+
+        guard.lock();
+        smesh->completed.push_back(std::make_pair(c, mesh));
+    }
+}
+
+
+StreamingMesh* open_streaming_mesh(const char filename[], size_t budget)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    StreamingMesh* smesh = new StreamingMesh();
+    struct stat st;
+    const StreamingMeshHeader& header = smesh->header;
+    bool valid = fstat(fd, &st) == 0 && pread(fd, &smesh->header, sizeof(StreamingMeshHeader), 0) == sizeof(StreamingMeshHeader)
+                 && memcmp(header.magic, SMESH_MAGIC, sizeof(SMESH_MAGIC)) == 0 && header.version == SMESH_VERSION;
+
+    // Only the chunk table is read up front. It and every chunk must lie within
+    // the file before anything is sized or read from them.
+    uint64_t size = valid ? st.st_size : 0;
+    valid = valid && header.chunk_table_offset >= sizeof(StreamingMeshHeader) && header.chunk_table_offset <= size
+            && header.num_chunks <= (size - header.chunk_table_offset) / sizeof(StreamingChunkInfo);
+    std::vector<StreamingChunkInfo> table(valid ? header.num_chunks : 0);
+    size_t table_size = table.size() * sizeof(StreamingChunkInfo);
+    if (table_size && pread(fd, &table[0], table_size, header.chunk_table_offset) != (ssize_t) table_size) valid = false;
+    for (size_t c = 0; valid && c < table.size(); c++) {
+        valid = table[c].offset % SMESH_PAGE_SIZE == 0 && table[c].offset <= size
+                && table[c].size >= sizeof(MeshFileHeader) && table[c].size <= size - table[c].offset;
+    }
+    if (!valid) {
+        fprintf(stderr, "Incompatible streaming mesh: %s\n", filename);
+        close(fd);
+        delete smesh;
+        return NULL;
+    }
+    smesh->chunks.resize(table.size());
+    for (size_t c = 0; c < table.size(); c++) {
+        smesh->chunks[c].info = table[c];
+        smesh->chunks[c].mesh = NULL;
+        smesh->chunks[c].state = CHUNK_ABSENT;
+        smesh->chunks[c].visible = false;
+        smesh->chunks[c].last_used = 0;
+    }
+    smesh->fd = fd;
+    smesh->budget = budget;
+    smesh->committed = 0;
+    smesh->frame = 0;
+    smesh->loads = 0;
+    smesh->failures = 0;
+    smesh->has_last_origin = false;
+    smesh->stop = false;
+    smesh->loader = std::thread(loader_main, smesh);
+    return smesh;
+}
+
+
+void close_streaming_mesh(StreamingMesh* smesh)
+{
+    {
+        std::lock_guard<std::mutex> guard(smesh->lock);
+        smesh->stop = true;
+    }
+    smesh->wake.notify_all();
+    smesh->loader.join();
+    for (size_t i = 0; i < smesh->completed.size(); i++) {
+        if (smesh->completed[i].second) free_mesh(smesh->completed[i].second);
+    }
+    for (size_t c = 0; c < smesh->chunks.size(); c++) {
+        if (smesh->chunks[c].mesh) free_mesh(smesh->chunks[c].mesh);
+    }
+    close(smesh->fd);
+    delete smesh;
+}
+
+
+static bool chunk_visible(Camera* cam, Eigen::Matrix4f& Mcam, Eigen::Matrix4f& M, StreamingChunkInfo* info)
+{
+    // Transform the chunk's bounding box corners.
+    Eigen::Vector4f corners_cam[8], corners_screen[8];
+    bool any_behind = false, all_behind = true, all_far = true;
+    for (int i = 0; i < 8; i++) {
+        Eigen::Vector4f p(i & 1 ? info->bounds_max[0] : info->bounds_min[0],
+                          i & 2 ? info->bounds_max[1] : info->bounds_min[1],
+                          i & 4 ? info->bounds_max[2] : info->bounds_min[2], 1);
+        corners_cam[i] = Mcam * p;
+        corners_screen[i] = M * p;
+        float z = corners_cam[i](2);
+        any_behind |= z >= cam->min_draw_dist;
+        all_behind &= z >= cam->min_draw_dist;
+        all_far &= z < cam->max_draw_dist;
+    }
+    if (all_behind || all_far) return false;
+
+    // Screen-space test is only valid when all corners are in front of the camera.
+    if (any_behind) return true;
+    bool left = true, right = true, below = true, above = true;
+    for (int i = 0; i < 8; i++) {
+        Eigen::Vector3f s = corners_screen[i].hnormalized();
+        left &= s(0) < 0;
+        right &= s(0) > cam->frame_width;
+        below &= s(1) < 0;
+        above &= s(1) > cam->frame_height;
+    }
+    return !(left || right || below || above);
+}
+
+
+static float chunk_distance(StreamingChunkInfo* info, Eigen::Vector3f origin)
+{
+    Eigen::Vector3f lo(info->bounds_min[0], info->bounds_min[1], info->bounds_min[2]);
+    Eigen::Vector3f hi(info->bounds_max[0], info->bounds_max[1], info->bounds_max[2]);
+    return (origin.cwiseMax(lo).cwiseMin(hi) - origin).norm();
+}
+
+
+static bool evict_one(StreamingMesh* smesh, std::vector<char>& wanted)
+{
+    // Evict the least recently used resident chunk that is not wanted this frame.
+    long victim = -1;
+    for (size_t c = 0; c < smesh->chunks.size(); c++) {
+        StreamingChunk& chunk = smesh->chunks[c];
+        if (chunk.state != CHUNK_RESIDENT || wanted[c]) continue;
+        if (victim < 0 || chunk.last_used < smesh->chunks[victim].last_used) victim = c;
+    }
+    if (victim < 0) return false;
+    StreamingChunk& chunk = smesh->chunks[victim];
+    free_mesh(chunk.mesh);
+    chunk.mesh = NULL;
+    chunk.state = CHUNK_ABSENT;
+    smesh->committed -= chunk.info.size;
+    return true;
+}
+
+
+void update_streaming_mesh(StreamingMesh* smesh, Camera* cam)
+{
+    PROFILE_ZONE("cull chunks");
+    smesh->frame++;
+    update_camera(cam);
+    Eigen::Matrix4f Mcam = cam->Mcam;
+    Eigen::Matrix4f M = cam->M;
+    Eigen::Vector3f origin = cam->origin;
+
+    // Predict where the camera will be from its motion since the last update.
+    bool predict = false;
+    Eigen::Matrix4f Mcam_next, M_next;
+    Eigen::Vector3f origin_next = origin;
+    if (smesh->has_last_origin && (origin - smesh->last_origin).norm() > 0) {
+        origin_next = origin + (origin - smesh->last_origin) * SMESH_PREFETCH_FRAMES;
+        Mcam_next = camera_transform(origin_next, cam->direction);
+        M_next = cam->Mvp * Mcam_next;
+        predict = true;
+    }
+    smesh->last_origin = origin;
+    smesh->has_last_origin = true;
+
+    // Rank chunks: visible ones by distance, then those about to become visible.
+    std::vector<std::pair<float, uint32_t> > ranked;
+    for (size_t c = 0; c < smesh->chunks.size(); c++) {
+        StreamingChunk& chunk = smesh->chunks[c];
+        chunk.visible = chunk_visible(cam, Mcam, M, &chunk.info);
+        if (chunk.visible) {
+            chunk.last_used = smesh->frame;
+            ranked.push_back(std::make_pair(chunk_distance(&chunk.info, origin), c));
+        } else if (predict && chunk_visible(cam, Mcam_next, M_next, &chunk.info)) {
+            ranked.push_back(std::make_pair(1e20f + chunk_distance(&chunk.info, origin_next), c));
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    // Take the best-ranked chunks that fit in the budget.
+    std::vector<char> wanted(smesh->chunks.size(), 0);
+    size_t planned = 0;
+    for (size_t i = 0; i < ranked.size(); i++) {
+        StreamingChunkInfo& info = smesh->chunks[ranked[i].second].info;
+        if (planned + info.size > smesh->budget) continue;
+        planned += info.size;
+        wanted[ranked[i].second] = 1;
+    }
+
+    std::unique_lock<std::mutex> guard(smesh->lock);
+
+    // Commit finished loads.
+    while (!smesh->completed.empty()) {
+        std::pair<uint32_t, Mesh*> done = smesh->completed.front();
+        smesh->completed.pop_front();
+        StreamingChunk& chunk = smesh->chunks[done.first];
+        chunk.mesh = done.second;
+        if (done.second) {
+            chunk.state = CHUNK_RESIDENT;
+            smesh->loads++;
+        } else {
+            // Retrying every frame would only fail again (corrupt file, or no memory).
+            chunk.state = CHUNK_FAILED;
+            smesh->committed -= chunk.info.size;
+            smesh->failures++;
+        }
+    }
+
+    // Drop queued requests that have not started; they are re-queued by rank below.
+    for (size_t i = 0; i < smesh->requests.size(); i++) {
+        StreamingChunk& chunk = smesh->chunks[smesh->requests[i]];
+        chunk.state = CHUNK_ABSENT;
+        smesh->committed -= chunk.info.size;
+    }
+    smesh->requests.clear();
+
+    // Request wanted chunks, evicting unwanted ones to stay within budget.
+    for (size_t i = 0; i < ranked.size(); i++) {
+        uint32_t c = ranked[i].second;
+        StreamingChunk& chunk = smesh->chunks[c];
+        if (!wanted[c] || chunk.state != CHUNK_ABSENT) continue;
+        while (smesh->committed + chunk.info.size > smesh->budget && evict_one(smesh, wanted));
+        if (smesh->committed + chunk.info.size > smesh->budget) break;
+        chunk.state = CHUNK_LOADING;
+        smesh->committed += chunk.info.size;
+        smesh->requests.push_back(c);
+    }
+    guard.unlock();
+    smesh->wake.notify_one();
+}
+
+
+size_t streaming_resident_bytes(StreamingMesh* smesh)
+{
+    // Resident chunks only; committed adds those still loading.
+    size_t bytes = 0;
+    for (size_t c = 0; c < smesh->chunks.size(); c++) {
+        if (smesh->chunks[c].state == CHUNK_RESIDENT) bytes += smesh->chunks[c].info.size;
+    }
+    return bytes;
+}
+
+
+void rasterize_streaming_mesh(Camera* cam, StreamingMesh* smesh, Texture* texture)
+{
+    // Draw the visible chunks that are resident; the rest appear as they stream in.
+    for (size_t c = 0; c < smesh->chunks.size(); c++) {
+        StreamingChunk& chunk = smesh->chunks[c];
+        if (chunk.state != CHUNK_RESIDENT || !chunk.visible) continue;
+        Object obj;
+        obj.mesh = chunk.mesh;
+        obj.texture = texture;
+        rasterize_mesh(cam, &obj);
+    }
+}
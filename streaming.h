@@ -0,0 +1,94 @@
+#ifndef _STREAMING_H_
+#define _STREAMING_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <Eigen/Dense>
+#include "types.h"
+
+
+#define SMESH_MAGIC "SMESH01"
+#define SMESH_VERSION 1
+#define SMESH_EXTENSION ".smesh"
+#define SMESH_PAGE_SIZE 4096
+#define SMESH_DEFAULT_CHUNK_FACES 16384
+#define SMESH_PREFETCH_FRAMES 15        // How far ahead of the camera to prefetch.
+
+#define CHUNK_ABSENT 0
+#define CHUNK_LOADING 1
+#define CHUNK_RESIDENT 2
+#define CHUNK_FAILED 3                  // Could not be read; never requested again.
+
+
+// Header of a streaming mesh file (.smesh). A table of chunk records follows,
+// then each chunk as a page-aligned binary mesh (see meshfile.h).
+struct StreamingMeshHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_chunks;
+    float bounds_min[3];
+    float bounds_max[3];
+    uint64_t chunk_table_offset;
+};
+
+
+struct StreamingChunkInfo {
+    float bounds_min[3];
+    float bounds_max[3];
+    uint64_t offset;
+    uint64_t size;
+    uint64_t num_vertices;
+    uint64_t num_faces;
+};
+
+
+struct StreamingChunk {
+    StreamingChunkInfo info;
+    Mesh* mesh;                     // Resident geometry, or NULL.
+    uint8_t state;
+    bool visible;
+    uint32_t last_used;
+};
+
+
+// Spatially partitioned mesh whose chunks are paged in and out under a memory budget.
+struct StreamingMesh {
+    int fd;
+    StreamingMeshHeader header;
+    std::vector<StreamingChunk> chunks;
+    size_t budget;
+    size_t committed;               // Bytes of resident and in-flight chunks.
+    uint32_t frame;
+    unsigned long loads;            // Chunks read so far.
+    unsigned long failures;         // Chunks that could not be read.
+    Eigen::Vector3f last_origin;
+    bool has_last_origin;
+
+    // Background loader state.
+    std::thread loader;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<uint32_t> requests;
+    std::deque<std::pair<uint32_t, Mesh*> > completed;
+    bool stop;
+};
+
+
+int build_streaming_mesh(const char src_filename[], const char dst_filename[], unsigned int max_chunk_faces);
+
+StreamingMesh* open_streaming_mesh(const char filename[], size_t budget);
+
+void close_streaming_mesh(StreamingMesh* smesh);
+
+void update_streaming_mesh(StreamingMesh* smesh, Camera* cam);
+
+size_t streaming_resident_bytes(StreamingMesh* smesh);
+
+void rasterize_streaming_mesh(Camera* cam, StreamingMesh* smesh, Texture* texture);
+
+
+#endif
@@ -0,0 +1,201 @@
+/* Project ........ Python Game Engine
+ * Filename ....... synth.c
+ * Description .... Synthetic meshes and scenes with controlled size, overdraw and instancing.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include "synth.h"
+#include "meshfile.h"
+#include "imports.h"
+
+
+static inline uint32_t next_random(uint32_t* state)
+{
+    // xorshift32; the state must be non-zero.
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+
+static inline float random_float(uint32_t* state)
+{
+    return (next_random(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+
+SynthParams default_synth_params()
+{
+    SynthParams params;
+    params.triangles = 100000;
+    params.overdraw = 4;
+    params.size_range = 16;
+    params.instances = 1;
+    params.layout = SYNTH_LAYOUT_STACK;
+    params.texture_size = 512;
+    params.seed = 1;
+    return params;
+}
+
+
+Mesh* synth_mesh(unsigned long triangles, float overdraw, float size_range, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 1;
+    const float R = SYNTH_FOOTPRINT_RADIUS;
+    const float depth = 0.25f * R;
+
+    // Areas are log-uniform over [1, size_range] times a unit scaled so their expected
+    // sum covers the disc `overdraw` times.
+    size_range = std::max(size_range, 1.0f);
+    float log_range = logf(size_range);
+    float mean_weight = size_range > 1 ? (size_range - 1) / log_range : 1;
+    float unit_area = overdraw * (float) M_PI * R * R / (std::max(triangles, 1ul) * mean_weight);
+
+    Mesh* mesh = create_mesh(3 * triangles, triangles);
+    float* v = mesh->v->data();
+    float* vt = mesh->vt->data();
+    float* vn = mesh->vn->data();
+    for (unsigned long i = 0; i < triangles; i++) {
+        float area = unit_area * expf(log_range * random_float(&state));
+        float circumradius = sqrtf(4 * area / sqrtf(3)) / sqrtf(3);
+
+        // Uniform position in the disc, random rotation and height.
+        float r = R * sqrtf(random_float(&state));
+        float phi = 2 * (float) M_PI * random_float(&state);
+        float theta = 2 * (float) M_PI * random_float(&state);
+        float cx = r * cosf(phi), cy = r * sinf(phi), cz = depth * random_float(&state);
+
+        // Counter-clockwise equilateral triangle seen from +z.
+        for (int k = 0; k < 3; k++) {
+            unsigned long j = 3 * i + k;
+            float angle = theta + k * 2 * (float) M_PI / 3;
+            v[4 * j + 0] = cx + circumradius * cosf(angle);
+            v[4 * j + 1] = cy + circumradius * sinf(angle);
+            v[4 * j + 2] = cz;
+            v[4 * j + 3] = 1;
+            vt[2 * j + 0] = std::min(std::max((v[4 * j + 0] + R) / (2 * R), 0.0f), 1.0f);
+            vt[2 * j + 1] = std::min(std::max((v[4 * j + 1] + R) / (2 * R), 0.0f), 1.0f);
+            vn[4 * j + 2] = 1;
+        }
+        mesh->f[i].i0 = 3 * i;
+        mesh->f[i].i1 = 3 * i + 1;
+        mesh->f[i].i2 = 3 * i + 2;
+    }
+    compute_mesh_bounds(mesh);
+    return mesh;
+}
+
+
+Texture* synth_texture(int size, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 1;
+    size = std::max(size, 1);
+
+    // Checkerboard of random colors; padded like load_texture.
+    const int cells = 8;
+    uint8_t palette[cells * cells][3];
+    for (int c = 0; c < cells * cells; c++) {
+        uint32_t x = next_random(&state);
+        palette[c][0] = 64 + (x & 0x7f);
+        palette[c][1] = 64 + ((x >> 8) & 0x7f);
+        palette[c][2] = 64 + ((x >> 16) & 0x7f);
+    }
+    uint8_t* data = (uint8_t*) malloc((size_t) size * size * 3 + 1);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int c = (y * cells / size) * cells + x * cells / size;
+            uint8_t shade = ((x * cells / size + y * cells / size) & 1) ? 255 : 191;
+            uint8_t* texel = data + 3 * ((size_t) y * size + x);
+            for (int k = 0; k < 3; k++) texel[k] = palette[c][k] * shade / 255;
+        }
+    }
+
+    Texture* tex = new Texture();
+    tex->width = size;
+    tex->height = size;
+    tex->data = data;
+    tex->virt = NULL;
+    return tex;
+}
+
+
+std::vector<Object> synth_scene(const SynthParams* params)
+{
+    // All instances share one mesh and texture.
+    unsigned int instances = std::max(params->instances, 1u);
+    float overdraw = params->layout == SYNTH_LAYOUT_STACK ? params->overdraw / instances : params->overdraw;
+    Mesh* mesh = synth_mesh(params->triangles / instances, overdraw, params->size_range, params->seed);
+    Texture* tex = synth_texture(params->texture_size, params->seed);
+
+    uint32_t state = params->seed ? params->seed : 1;
+    int columns = (int) ceilf(sqrtf(instances));
+    float spacing = 2 * SYNTH_FOOTPRINT_RADIUS + 0.5f;
+    std::vector<Object> objects(instances);
+    for (unsigned int i = 0; i < instances; i++) {
+        Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+        if (params->layout == SYNTH_LAYOUT_GRID) {
+            transform.translate(Eigen::Vector3f((i % columns - (columns - 1) / 2.0f) * spacing,
+                                                (i / columns - (columns - 1) / 2.0f) * spacing, 0));
+        } else {
+            transform.translate(Eigen::Vector3f(0, 0, 0.01f * i));
+        }
+        transform.rotate(Eigen::AngleAxisf(2 * (float) M_PI * random_float(&state), Eigen::Vector3f::UnitZ()));
+        objects[i].mesh = mesh;
+        objects[i].texture = tex;
+        objects[i].transform = transform.matrix();
+    }
+    return objects;
+}
+
+
+void free_synth_scene(std::vector<Object>& objects)
+{
+    if (!objects.empty()) {
+        free_mesh(objects[0].mesh);
+        free_texture(objects[0].texture);
+    }
+    objects.clear();
+}
+
+
+int write_obj(const char filename[], const std::vector<Object>& objects)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file) return -1;
+
+    // Objects are written in world space; OBJ indices are global and 1-based.
+    unsigned long base = 1;
+    for (size_t o = 0; o < objects.size(); o++) {
+        Mesh* mesh = objects[o].mesh;
+        if (mesh->qv) {
+            fclose(file);
+            return -1;
+        }
+        Eigen::Matrix4f M = objects[o].transform;
+        Eigen::Matrix3f N = M.topLeftCorner<3, 3>().inverse().transpose();
+        fprintf(file, "o object_%zu\n", o);
+        for (unsigned long i = 0; i < mesh->num_vertices; i++) {
+            Eigen::Vector3f p = (M * mesh->v->col(i)).head<3>();
+            fprintf(file, "v %.6f %.6f %.6f\n", p(0), p(1), p(2));
+        }
+        for (unsigned long i = 0; i < mesh->num_vertices; i++) {
+            fprintf(file, "vt %.6f %.6f\n", (*mesh->vt)(0, i), (*mesh->vt)(1, i));
+        }
+        for (unsigned long i = 0; i < mesh->num_vertices; i++) {
+            Eigen::Vector3f n = (N * mesh->vn->col(i).head<3>()).normalized();
+            fprintf(file, "vn %.6f %.6f %.6f\n", n(0), n(1), n(2));
+        }
+        for (unsigned long i = 0; i < mesh->num_faces; i++) {
+            unsigned long a = base + mesh->f[i].i0, b = base + mesh->f[i].i1, c = base + mesh->f[i].i2;
+            fprintf(file, "f %lu/%lu/%lu %lu/%lu/%lu %lu/%lu/%lu\n", a, a, a, b, b, b, c, c, c);
+        }
+        base += mesh->num_vertices;
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
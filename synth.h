@@ -0,0 +1,41 @@
+#ifndef _SYNTH_H_
+#define _SYNTH_H_
+#include <stdint.h>
+#include <vector>
+#include "types.h"
+
+
+#define SYNTH_LAYOUT_STACK 0        // Instances overlap on one footprint; overdraw is shared.
+#define SYNTH_LAYOUT_GRID 1         // Instances side by side; each has the full overdraw.
+
+#define SYNTH_FOOTPRINT_RADIUS 2.0f // Triangles fall in a disc of this radius around the origin.
+
+
+// Parameters of a synthetic scene. Triangles are flat, face +z and are scattered
+// over a disc so that their total area is overdraw times the disc area, giving
+// an average depth complexity of `overdraw` when seen from above.
+struct SynthParams {
+    unsigned long triangles;        // Total over all instances.
+    float overdraw;
+    float size_range;               // Ratio of largest to smallest triangle area (1 = uniform).
+    unsigned int instances;
+    int layout;
+    int texture_size;               // Width and height of the texture in texels.
+    uint32_t seed;
+};
+
+
+SynthParams default_synth_params();
+
+Mesh* synth_mesh(unsigned long triangles, float overdraw, float size_range, uint32_t seed);
+
+Texture* synth_texture(int size, uint32_t seed);
+
+std::vector<Object> synth_scene(const SynthParams* params);
+
+void free_synth_scene(std::vector<Object>& objects);
+
+int write_obj(const char filename[], const std::vector<Object>& objects);
+
+
+#endif
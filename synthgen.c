@@ -0,0 +1,62 @@
+/* Project ........ Python Game Engine
+ * Filename ....... synthgen.c
+ * Description .... Command line tool writing synthetic scenes as OBJ plus a PNG texture.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -march=native -DNO_GLFW -o synthgen synthgen.c synth.c backend.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "synth.h"
+#include "backend.h"
+
+
+static void usage(const char name[])
+{
+    printf("usage: %s [--triangles N] [--overdraw D] [--size-range R] [--instances K] [--grid]\n"
+           "          [--texture SIZE] [--seed S] output.obj [texture.png]\n", name);
+}
+
+
+int main(int argc, char* argv[])
+{
+    SynthParams params = default_synth_params();
+    const char* obj_filename = NULL;
+    const char* png_filename = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) params.triangles = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--overdraw") == 0 && i + 1 < argc) params.overdraw = atof(argv[++i]);
+        else if (strcmp(argv[i], "--size-range") == 0 && i + 1 < argc) params.size_range = atof(argv[++i]);
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) params.instances = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--grid") == 0) params.layout = SYNTH_LAYOUT_GRID;
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) params.texture_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) params.seed = strtoul(argv[++i], NULL, 10);
+        else if (argv[i][0] != '-' && !obj_filename) obj_filename = argv[i];
+        else if (argv[i][0] != '-' && !png_filename) png_filename = argv[i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!obj_filename) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Object> objects = synth_scene(&params);
+    printf("%zu instances of %lu triangles, overdraw %.1f\n", objects.size(), objects[0].mesh->num_faces, params.overdraw);
+    if (write_obj(obj_filename, objects) != 0) {
+        printf("Could not write %s\n", obj_filename);
+        return 1;
+    }
+    if (png_filename) {
+        Texture* tex = objects[0].texture;
+        if (write_png(png_filename, tex->data, tex->width, tex->height) != 0) {
+            printf("Could not write %s\n", png_filename);
+            return 1;
+        }
+    }
+    free_synth_scene(objects);
+    return 0;
+}
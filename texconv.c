@@ -0,0 +1,33 @@
+/* Project ........ Python Game Engine
+ * Filename ....... texconv.c
+ * Description .... Converts PNG textures into paged (.vtex) textures for streaming.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -o texconv texconv.c vtexture.c jobs.c imports.c meshfile.c vcache.c quantize.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "vtexture.h"
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printf("usage: %s <input.png> <output.vtex> [tile_size]\n", argv[0]);
+        return 1;
+    }
+    unsigned int tile_size = argc > 3 ? atoi(argv[3]) : VT_DEFAULT_TILE_SIZE;
+    if (!vt_valid_tile_size(tile_size)) {
+        printf("Tile size must be a power of two from %d to %d\n", VT_MIN_TILE_SIZE, VT_MAX_TILE_SIZE);
+        return 1;
+    }
+    if (tile_size != VT_DEFAULT_TILE_SIZE) {
+        printf("Note: the engine's tile cache uses %d x %d tiles and opens only those\n", VT_DEFAULT_TILE_SIZE, VT_DEFAULT_TILE_SIZE);
+    }
+    if (create_paged_texture(argv[1], argv[2], tile_size) != 0) {
+        printf("Failed to convert %s\n", argv[1]);
+        return 1;
+    }
+    printf("Wrote %s\n", argv[2]);
+    return 0;
+}
@@ -5,54 +5,106 @@
 #include <Eigen/Dense>
 
 
+// Triangle as three indices into the mesh's unified vertex buffer.
 struct Tri {
-    unsigned int iv0;
-    unsigned int iv1;
-    unsigned int iv2;
-    
-    unsigned int ivt0;
-    unsigned int ivt1;
-    unsigned int ivt2;
-    
-    unsigned int ivn0;
-    unsigned int ivn1;
-    unsigned int ivn2;
+    unsigned int i0;
+    unsigned int i1;
+    unsigned int i2;
 };
 
 
+// Vertex attributes are stored SoA: column i of v, vn and vt together form vertex i.
+// Quantized meshes instead store qv (16-bit x, y and z planes relative to the
+// bounding box), qvn (octahedral 2x8-bit normals) and qvt (half u, v pairs).
 struct Mesh {
-    Eigen::MatrixXf* v;
-    Eigen::MatrixXf* vn;
-    Eigen::MatrixXf* vt;
-    std::vector<Tri>* f;
+    Eigen::Map<Eigen::MatrixXf>* v;
+    Eigen::Map<Eigen::MatrixXf>* vn;
+    Eigen::Map<Eigen::MatrixXf>* vt;
+    uint16_t* qv;
+    uint16_t* qvn;
+    uint16_t* qvt;
+    float qscale[3];
+    float qoffset[3];
+    Tri* f;
+    unsigned long num_vertices;
+    unsigned long num_faces;
+    void* storage;          // Block holding all streams (see meshfile.h).
+    size_t storage_size;
+    bool mapped;            // Storage is a read-only file mapping.
 };
 
 
+struct VirtualTexture;
+
+
 struct Texture {
 	int width;
 	int height;
 	uint8_t* data;
+	VirtualTexture* virt;   // Paged texture (data is NULL) or NULL.
 };
 
 
 struct Object {
     Mesh* mesh;
-    Texture* texture;
+    Texture* texture;                                          // May be NULL (depth only).
+    Eigen::Matrix4f transform = Eigen::Matrix4f::Identity();   // Model to world.
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 
+#define TILE_SIZE 8                 // Frame buffer tiles are TILE_SIZE x TILE_SIZE pixels.
+#define TILE_PIXELS (TILE_SIZE * TILE_SIZE)
+
+
+// Rasterizer counters, accumulated when built with -DRASTER_STATS.
+struct RasterStats {
+    unsigned long triangles;        // Submitted.
+    unsigned long backfacing;       // Culled as back faces.
+    unsigned long clipped;          // Bounding box entirely outside the frame.
+    unsigned long empty;            // Set up but covering no pixel centre.
+    unsigned long pixels_tested;    // Pixels of the clamped bounding boxes.
+    unsigned long pixels_covered;
+    unsigned long pixels_occluded;  // Covered but failing the depth test.
+    unsigned long pixels_shaded;
+};
+
+
+// Pose and projection are held by value. move_camera only marks the pose
+// dirty; update_camera recomputes the combined transform when needed.
 struct Camera {
-    Eigen::Matrix4f* Mvp;
-    Eigen::Matrix4f* Mcam;
-    Eigen::Vector3f* origin;
-    Eigen::Vector3f* direction;
+    Eigen::Matrix4f Mvp;
+    Eigen::Matrix4f Mcam;
+    Eigen::Matrix4f M;              // Mvp * Mcam.
+    Eigen::Matrix4f M_inv_T;        // Inverse transpose of M, for normals.
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;
+    bool dirty;
     int frame_width;
     int frame_height;
-    unsigned char* frame_buffer;
-    double* depth_buffer;
+    uint32_t* color_buffer;         // RGBA8, tiled (see tile_offset).
+    float* depth_buffer;            // Tiled like color_buffer.
+    unsigned char* frame_buffer;    // Linear bottom-up RGB image written by resolve_camera.
     double min_draw_dist;
     double max_draw_dist;
+    int tiles_x;
+    int tiles_y;
+    uint32_t* tile_epoch;           // Frame in which each tile was last cleared.
+    uint32_t epoch;                 // Current frame; tiles with an older stamp are stale.
+    RasterStats stats;              // Zero unless built with -DRASTER_STATS.
+    int view;                       // What resolve_camera shows (see camera.h).
+    uint16_t* overdraw_buffer;      // Tiled fragment counts for VIEW_OVERDRAW, or NULL.
+    bool reference;                 // Render through the scalar reference paths (see golden.c).
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 
+// Index of pixel (x, row) in the tiled buffers. Tiles are stored row-major
+// in buffer row order, and each holds its pixels row-major.
+static inline unsigned int tile_offset(int tiles_x, int x, int row)
+{
+    return ((row / TILE_SIZE) * tiles_x + x / TILE_SIZE) * TILE_PIXELS + (row % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+}
+
+
 #endif
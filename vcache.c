@@ -0,0 +1,193 @@
+/* Project ........ Python Game Engine
+ * Filename ....... vcache.c
+ * Description .... Post-transform vertex cache optimisation (Forsyth) and statistics.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <Eigen/Dense>
+#include "types.h"
+#include "vcache.h"
+
+
+static float vertex_score(int cache_pos, int remaining)
+{
+    // Vertices without remaining triangles never attract new ones.
+    if (remaining == 0) return -1.0f;
+
+    // Reward recently used vertices (the last triangle's three equally).
+    float score = 0;
+    if (cache_pos >= 0) {
+        if (cache_pos < 3) score = 0.75f;
+        else score = powf(1.0f - (cache_pos - 3) * (1.0f / (VCACHE_SIZE - 3)), 1.5f);
+    }
+
+    // Boost vertices with few remaining triangles so they get finished off.
+    return score + 2.0f * powf((float) remaining, -0.5f);
+}
+
+
+static void reorder_triangles(Mesh* mesh)
+{
+    unsigned long num_vertices = mesh->num_vertices;
+    unsigned long num_faces = mesh->num_faces;
+    unsigned int* indices = &mesh->f[0].i0;
+
+    // Triangle adjacency per vertex (CSR); the first remaining[v] entries are live.
+    std::vector<unsigned int> offsets(num_vertices + 1, 0);
+    for (unsigned long i = 0; i < 3 * num_faces; i++) offsets[indices[i] + 1]++;
+    for (unsigned long v = 0; v < num_vertices; v++) offsets[v + 1] += offsets[v];
+    std::vector<unsigned int> adjacency(3 * num_faces);
+    std::vector<int> remaining(num_vertices, 0);
+    for (unsigned long i = 0; i < 3 * num_faces; i++) {
+        unsigned int v = indices[i];
+        adjacency[offsets[v] + remaining[v]++] = i / 3;
+    }
+
+    std::vector<int> cache_pos(num_vertices, -1);
+    std::vector<float> vscore(num_vertices);
+    for (unsigned long v = 0; v < num_vertices; v++) vscore[v] = vertex_score(-1, remaining[v]);
+    std::vector<float> tscore(num_faces);
+    std::vector<char> added(num_faces, 0);
+    long best = -1;
+    for (unsigned long t = 0; t < num_faces; t++) {
+        tscore[t] = vscore[indices[3 * t]] + vscore[indices[3 * t + 1]] + vscore[indices[3 * t + 2]];
+        if (best < 0 || tscore[t] > tscore[best]) best = t;
+    }
+
+    std::vector<Tri> order;
+    order.reserve(num_faces);
+    std::vector<unsigned int> cache, next_cache;
+    unsigned long cursor = 0;
+
+    for (unsigned long k = 0; k < num_faces; k++) {
+        // Without a candidate near the cache, continue with the next unused triangle.
+        if (best < 0) {
+            while (added[cursor]) cursor++;
+            best = cursor;
+        }
+        added[best] = 1;
+        order.push_back(mesh->f[best]);
+        unsigned int* tri = &indices[3 * best];
+
+        // Drop the triangle from its vertices' live adjacency.
+        for (int c = 0; c < 3; c++) {
+            unsigned int v = tri[c];
+            unsigned int* adj = &adjacency[offsets[v]];
+            for (int j = 0; j < remaining[v]; j++) {
+                if (adj[j] == (unsigned int) best) {
+                    std::swap(adj[j], adj[remaining[v] - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // Move the triangle's vertices to the front of the simulated cache.
+        next_cache.assign(tri, tri + 3);
+        for (size_t j = 0; j < cache.size(); j++) {
+            if (cache[j] != tri[0] && cache[j] != tri[1] && cache[j] != tri[2]) next_cache.push_back(cache[j]);
+        }
+
+        // Rescore affected vertices; those pushed out of the cache lose their position.
+        for (size_t j = 0; j < next_cache.size(); j++) {
+            unsigned int v = next_cache[j];
+            cache_pos[v] = j < VCACHE_SIZE ? (int) j : -1;
+            vscore[v] = vertex_score(cache_pos[v], remaining[v]);
+        }
+
+        // Rescore triangles around them and pick the best as the next one.
+        best = -1;
+        for (size_t j = 0; j < next_cache.size(); j++) {
+            unsigned int v = next_cache[j];
+            for (int a = 0; a < remaining[v]; a++) {
+                unsigned int t = adjacency[offsets[v] + a];
+                tscore[t] = vscore[indices[3 * t]] + vscore[indices[3 * t + 1]] + vscore[indices[3 * t + 2]];
+                if (best < 0 || tscore[t] > tscore[best]) best = t;
+            }
+        }
+        if (next_cache.size() > VCACHE_SIZE) next_cache.resize(VCACHE_SIZE);
+        cache.swap(next_cache);
+    }
+    std::copy(order.begin(), order.end(), mesh->f);
+}
+
+
+static void reorder_vertices(Mesh* mesh)
+{
+    // Number vertices in order of first use, unreferenced ones last.
+    unsigned long num_vertices = mesh->num_vertices;
+    unsigned int* indices = &mesh->f[0].i0;
+    std::vector<unsigned int> remap(num_vertices, 0xffffffffu);
+    unsigned int next = 0;
+    for (unsigned long i = 0; i < 3 * mesh->num_faces; i++) {
+        if (remap[indices[i]] == 0xffffffffu) remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (unsigned long v = 0; v < num_vertices; v++) {
+        if (remap[v] == 0xffffffffu) remap[v] = next++;
+    }
+
+    // Permute the attribute streams accordingly.
+    Eigen::MatrixXf v = *mesh->v, vt = *mesh->vt, vn = *mesh->vn;
+    for (unsigned long i = 0; i < num_vertices; i++) {
+        mesh->v->col(remap[i]) = v.col(i);
+        mesh->vt->col(remap[i]) = vt.col(i);
+        mesh->vn->col(remap[i]) = vn.col(i);
+    }
+}
+
+
+void optimize_vertex_cache(Mesh* mesh)
+{
+    if (mesh->num_faces == 0) return;
+    reorder_triangles(mesh);
+    
+    // Quantized meshes are built from already optimised float meshes.
+    if (mesh->v) reorder_vertices(mesh);
+}
+
+
+static unsigned long count_cache_misses(Mesh* mesh, int cache_size)
+{
+    // Simulate a FIFO post-transform cache as found in hardware.
+    std::vector<long> entered(mesh->num_vertices, -1);
+    unsigned long misses = 0;
+    unsigned int* indices = &mesh->f[0].i0;
+    for (unsigned long i = 0; i < 3 * mesh->num_faces; i++) {
+        unsigned int v = indices[i];
+        if (entered[v] < 0 || (long) misses - entered[v] >= cache_size) {
+            entered[v] = misses;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+
+double compute_acmr(Mesh* mesh, int cache_size)
+{
+    // Average cache miss ratio: transformed vertices per triangle.
+    if (mesh->num_faces == 0) return 0;
+    return (double) count_cache_misses(mesh, cache_size) / mesh->num_faces;
+}
+
+
+double compute_atvr(Mesh* mesh, int cache_size)
+{
+    // Average transform to vertex ratio: 1.0 means every vertex is transformed once.
+    std::vector<char> used(mesh->num_vertices, 0);
+    unsigned long num_used = 0;
+    unsigned int* indices = &mesh->f[0].i0;
+    for (unsigned long i = 0; i < 3 * mesh->num_faces; i++) {
+        if (!used[indices[i]]) {
+            used[indices[i]] = 1;
+            num_used++;
+        }
+    }
+    if (num_used == 0) return 0;
+    return (double) count_cache_misses(mesh, cache_size) / num_used;
+}
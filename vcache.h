@@ -0,0 +1,17 @@
+#ifndef _VCACHE_H_
+#define _VCACHE_H_
+#include "types.h"
+
+
+// Size of the LRU cache modelled by the Forsyth triangle scoring.
+#define VCACHE_SIZE 32
+
+
+void optimize_vertex_cache(Mesh* mesh);
+
+double compute_acmr(Mesh* mesh, int cache_size);
+
+double compute_atvr(Mesh* mesh, int cache_size);
+
+
+#endif
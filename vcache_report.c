@@ -0,0 +1,45 @@
+/* Project ........ Python Game Engine
+ * Filename ....... vcache_report.c
+ * Description .... Reports vertex cache efficiency (ACMR/ATVR) of an OBJ before and after optimisation.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ * Compile ........ g++ -O3 -o vcache_report vcache_report.c imports.c meshfile.c vcache.c quantize.c vtexture.c jobs.c -lpthread
+ */
+#include <stdio.h>
+#include "imports.h"
+#include "meshfile.h"
+#include "vcache.h"
+
+
+// FIFO cache sizes to report, covering small and large post-transform caches.
+static const int cache_sizes[] = {8, 16, 32};
+
+
+static void report(const char label[], Mesh* mesh)
+{
+    printf("%-8s", label);
+    for (int i = 0; i < 3; i++) {
+        printf("  ACMR(%2d) %.3f  ATVR(%2d) %.3f", cache_sizes[i], compute_acmr(mesh, cache_sizes[i]),
+               cache_sizes[i], compute_atvr(mesh, cache_sizes[i]));
+    }
+    printf("\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("usage: %s <mesh.obj>...\n", argv[0]);
+        return 1;
+    }
+    for (int i = 1; i < argc; i++) {
+        Mesh* mesh = load_mesh(argv[i]);
+        if (!mesh) return 1;
+        printf("%s: %lu vertices, %lu triangles\n", argv[i], mesh->num_vertices, mesh->num_faces);
+        report("before", mesh);
+        optimize_vertex_cache(mesh);
+        report("after", mesh);
+        free_mesh(mesh);
+    }
+    return 0;
+}
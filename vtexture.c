@@ -0,0 +1,462 @@
+/* Project ........ Python Game Engine
+ * Filename ....... vtexture.c
+ * Description .... Virtual texturing: paged texture files, tile cache and streaming.
+ * Created by ..... Thomas Bellucci
+ * Date ........... Oct 19th, 2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#include <Eigen/Dense>
+#include "types.h"
+#include "vtexture.h"
+#include "profiler.h"
+#include "jobs.h"
+#include "stb_image.h"
+
+
+uint8_t* downsample_rgb(const uint8_t* src, unsigned int w, unsigned int h, unsigned int* out_w, unsigned int* out_h)
+{
+    // Halve each dimension with a 2x2 box filter (clamping odd edges).
+    // Padded by a byte like loaded textures, so the result can be shaded directly.
+    unsigned int nw = std::max(1u, w / 2);
+    unsigned int nh = std::max(1u, h / 2);
+    uint8_t* dst = (uint8_t*) malloc(nw * nh * 3 + 1);
+
+    // Bands of output rows are independent jobs.
+    size_t rows = std::max(1u, VT_MIP_BATCH_TEXELS / nw);
+    parallel_for(default_job_system(), 0, nh, rows, [=](size_t first, size_t last) {
+        for (unsigned int y = first; y < last; y++) {
+            unsigned int y0 = std::min(2 * y, h - 1);
+            unsigned int y1 = std::min(2 * y + 1, h - 1);
+            for (unsigned int x = 0; x < nw; x++) {
+                unsigned int x0 = std::min(2 * x, w - 1);
+                unsigned int x1 = std::min(2 * x + 1, w - 1);
+                for (int c = 0; c < 3; c++) {
+                    unsigned int sum = src[3 * (y0 * w + x0) + c] + src[3 * (y0 * w + x1) + c]
+                                     + src[3 * (y1 * w + x0) + c] + src[3 * (y1 * w + x1) + c];
+                    dst[3 * (y * nw + x) + c] = (sum + 2) / 4;
+                }
+            }
+        }
+    });
+    *out_w = nw;
+    *out_h = nh;
+    return dst;
+}
+
+
+bool vt_valid_tile_size(unsigned int tile_size)
+{
+    // Shared by the converter and the loader, so every file written can be opened.
+    return tile_size >= VT_MIN_TILE_SIZE && tile_size <= VT_MAX_TILE_SIZE && (tile_size & (tile_size - 1)) == 0;
+}
+
+
+int create_paged_texture(const char src_filename[], const char dst_filename[], unsigned int tile_size)
+{
+    if (!vt_valid_tile_size(tile_size)) return -1;
+    int width, height, bpp;
+    uint8_t* data = stbi_load(src_filename, &width, &height, &bpp, 3);
+    if (!data) return -1;
+
+    PagedTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, VT_MAGIC, sizeof(VT_MAGIC));
+    header.version = VT_VERSION;
+    header.width = width;
+    header.height = height;
+    header.tile_size = tile_size;
+
+    // Build the mip chain down to the first level that fits in a single tile.
+    std::vector<uint8_t*> mips;
+    unsigned int w = width, h = height;
+    mips.push_back(data);
+    header.mip_width[0] = w;
+    header.mip_height[0] = h;
+    while ((w > tile_size || h > tile_size) && mips.size() < VT_MAX_MIPS) {
+        mips.push_back(downsample_rgb(mips.back(), w, h, &w, &h));
+        header.mip_width[mips.size() - 1] = w;
+        header.mip_height[mips.size() - 1] = h;
+    }
+    header.num_mips = mips.size();
+
+    // Lay out tiles page-aligned after the header.
+    unsigned long tile_bytes = tile_size * tile_size * 3;
+    uint64_t offset = 4096;
+    for (unsigned int m = 0; m < header.num_mips; m++) {
+        header.tiles_x[m] = (header.mip_width[m] + tile_size - 1) / tile_size;
+        header.tiles_y[m] = (header.mip_height[m] + tile_size - 1) / tile_size;
+        header.mip_offset[m] = offset;
+        offset += (uint64_t) header.tiles_x[m] * header.tiles_y[m] * tile_bytes;
+    }
+
+    FILE* file = fopen(dst_filename, "wb");
+    if (!file) return -1;
+    uint8_t pad[4096] = {0};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(pad, 4096 - sizeof(header), 1, file);
+
+    // Write tiles, replicating the last row/column into partial edge tiles.
+    uint8_t* tile = (uint8_t*) malloc(tile_bytes);
+    for (unsigned int m = 0; m < header.num_mips; m++) {
+        unsigned int mw = header.mip_width[m];
+        unsigned int mh = header.mip_height[m];
+        for (unsigned int ty = 0; ty < header.tiles_y[m]; ty++) {
+            for (unsigned int tx = 0; tx < header.tiles_x[m]; tx++) {
+                for (unsigned int r = 0; r < tile_size; r++) {
+                    unsigned int sy = std::min(ty * tile_size + r, mh - 1);
+                    for (unsigned int c = 0; c < tile_size; c++) {
+                        unsigned int sx = std::min(tx * tile_size + c, mw - 1);
+                        memcpy(&tile[3 * (r * tile_size + c)], &mips[m][3 * (sy * mw + sx)], 3);
+                    }
+                }
+                fwrite(tile, tile_bytes, 1, file);
+            }
+        }
+    }
+    fclose(file);
+
+    free(tile);
+    stbi_image_free(mips[0]);
+    for (unsigned int m = 1; m < mips.size(); m++) free(mips[m]);
+    return 0;
+}
+
+
+static void loader_main(VTCache* cache)
+{
+    PROFILE_THREAD("tile loader");
+    std::unique_lock<std::mutex> guard(cache->lock);
+    while (true) {
+        cache->wake.wait(guard, [cache] { return cache->stop || !cache->requests.empty(); });
+        if (cache->stop) return;
+        VTStagedTile req = cache->requests.front();
+        cache->requests.pop_front();
+        cache->loading = req.tex;
+        guard.unlock();
+
+        // Copy the tile out of the mapping; page faults are taken here, off the render thread.
+        PROFILE_ZONE("load tile");
+        VirtualTexture* vt = req.tex;
+        unsigned int mip = 0;
+        while (mip + 1 < vt->header.num_mips && req.tile >= vt->mip_base[mip + 1]) mip++;
+        uint64_t offset = vt->header.mip_offset[mip] + (uint64_t) (req.tile - vt->mip_base[mip]) * vt->tile_bytes;
+        req.data = (uint8_t*) malloc(vt->tile_bytes);
+        memcpy(req.data, vt->file + offset, vt->tile_bytes);
+
+        guard.lock();
+        cache->completed.push_back(req);
+        cache->loading = NULL;
+    }
+}
+
+
+VTCache* create_vt_cache(unsigned int num_slots, unsigned int tile_size)
+{
+    VTCache* cache = new VTCache();
+    cache->tile_size = tile_size;
+    cache->tile_bytes = tile_size * tile_size * 3;
+    cache->num_slots = num_slots;
+    cache->slots = new uint8_t[(size_t) num_slots * cache->tile_bytes];
+    cache->slot_owner = new VirtualTexture*[num_slots]();
+    cache->slot_tile = new uint32_t[num_slots]();
+    cache->slot_last_used = new uint32_t[num_slots]();
+    cache->slot_pinned = new uint8_t[num_slots]();
+    cache->frame = 1;
+    cache->loading = NULL;
+    cache->pending = 0;
+    cache->stop = false;
+    cache->loader = std::thread(loader_main, cache);
+    return cache;
+}
+
+
+VTCache* vt_default_cache()
+{
+    static VTCache* cache = create_vt_cache(VT_DEFAULT_CACHE_SLOTS, VT_DEFAULT_TILE_SIZE);
+    return cache;
+}
+
+
+void destroy_vt_cache(VTCache* cache)
+{
+    {
+        std::lock_guard<std::mutex> guard(cache->lock);
+        cache->stop = true;
+    }
+    cache->wake.notify_all();
+    cache->loader.join();
+    for (size_t i = 0; i < cache->completed.size(); i++) free(cache->completed[i].data);
+
+    delete[] cache->slots;
+    delete[] cache->slot_owner;
+    delete[] cache->slot_tile;
+    delete[] cache->slot_last_used;
+    delete[] cache->slot_pinned;
+    delete cache;
+}
+
+
+static int acquire_slot(VTCache* cache)
+{
+    // Prefer a free slot, otherwise evict the least recently used one not touched this frame.
+    int victim = -1;
+    for (unsigned int s = 0; s < cache->num_slots; s++) {
+        if (cache->slot_pinned[s]) continue;
+        if (!cache->slot_owner[s]) return s;
+        if (cache->slot_last_used[s] >= cache->frame) continue;
+        if (victim < 0 || cache->slot_last_used[s] < cache->slot_last_used[victim]) victim = s;
+    }
+    if (victim >= 0) {
+        VirtualTexture* owner = cache->slot_owner[victim];
+        owner->page_table[cache->slot_tile[victim]] = -1;
+        owner->tile_state[cache->slot_tile[victim]] = VT_TILE_ABSENT;
+        cache->slot_owner[victim] = NULL;
+    }
+    return victim;
+}
+
+
+static void commit_tile(VTCache* cache, int slot, VirtualTexture* vt, uint32_t tile, uint8_t* data)
+{
+    memcpy(cache->slots + (size_t) slot * cache->tile_bytes, data, cache->tile_bytes);
+    cache->slot_owner[slot] = vt;
+    cache->slot_tile[slot] = tile;
+    cache->slot_last_used[slot] = cache->frame;
+    vt->page_table[tile] = slot;
+    vt->tile_state[tile] = VT_TILE_RESIDENT;
+}
+
+
+static bool mip_fits(const PagedTextureHeader* header, unsigned int m, uint64_t tile_bytes, uint64_t size)
+{
+    // A level no larger than the one above, tiled as the converter tiles it,
+    // with all of its tiles between the header and the end of the file.
+    uint64_t w = header->mip_width[m], h = header->mip_height[m], tile_size = header->tile_size;
+    uint64_t above_w = m ? header->mip_width[m - 1] : header->width;
+    uint64_t above_h = m ? header->mip_height[m - 1] : header->height;
+    if (!w || !h || w > above_w || h > above_h || (m == 0 && (w != above_w || h != above_h))) return false;
+    if (header->tiles_x[m] != (w + tile_size - 1) / tile_size || header->tiles_y[m] != (h + tile_size - 1) / tile_size) return false;
+    uint64_t offset = header->mip_offset[m];
+    uint64_t tiles = (uint64_t) header->tiles_x[m] * header->tiles_y[m];
+    return offset >= sizeof(PagedTextureHeader) && offset <= size && tiles <= (size - offset) / tile_bytes;
+}
+
+
+VirtualTexture* open_paged_texture(const char filename[], VTCache* cache)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(PagedTextureHeader)) {
+        fprintf(stderr, "Incompatible paged texture: %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+    uint8_t* file = (uint8_t*) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (file == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    VirtualTexture* vt = new VirtualTexture();
+    memcpy(&vt->header, file, sizeof(PagedTextureHeader));
+    bool valid = memcmp(vt->header.magic, VT_MAGIC, sizeof(VT_MAGIC)) == 0 && vt->header.version == VT_VERSION
+                 && vt_valid_tile_size(vt->header.tile_size) && vt->header.tile_size == cache->tile_size
+                 && vt->header.num_mips >= 1 && vt->header.num_mips <= VT_MAX_MIPS && vt->header.width && vt->header.height;
+
+    // Tiles are copied straight out of the mapping, so every level must lie within it.
+    for (unsigned int m = 0; valid && m < vt->header.num_mips; m++) {
+        valid = mip_fits(&vt->header, m, cache->tile_bytes, st.st_size);
+    }
+    if (!valid) {
+        fprintf(stderr, "Incompatible paged texture: %s\n", filename);
+        munmap(file, st.st_size);
+        close(fd);
+        delete vt;
+        return NULL;
+    }
+    vt->fd = fd;
+    vt->file = file;
+    vt->file_size = st.st_size;
+    vt->tile_bytes = cache->tile_bytes;
+    vt->cache = cache;
+
+    // Allocate page tables for all mips.
+    vt->num_tiles = 0;
+    for (unsigned int m = 0; m < vt->header.num_mips; m++) {
+        vt->mip_base[m] = vt->num_tiles;
+        vt->num_tiles += vt->header.tiles_x[m] * vt->header.tiles_y[m];
+    }
+    vt->page_table = new int[vt->num_tiles];
+    std::fill(vt->page_table, vt->page_table + vt->num_tiles, -1);
+    vt->tile_state = new uint8_t[vt->num_tiles]();
+    vt->requested = new uint32_t[vt->num_tiles]();
+
+    // Pin the coarsest mip so every lookup has something to fall back on.
+    // Textures may be opened from loader threads, so slots are taken under the cache lock.
+    std::lock_guard<std::mutex> guard(cache->lock);
+    unsigned int last = vt->header.num_mips - 1;
+    for (unsigned int t = vt->mip_base[last]; t < vt->num_tiles; t++) {
+        int slot = acquire_slot(cache);
+        if (slot < 0) {
+            fprintf(stderr, "Virtual texture cache too small for %s\n", filename);
+            break;
+        }
+        uint64_t offset = vt->header.mip_offset[last] + (uint64_t) (t - vt->mip_base[last]) * vt->tile_bytes;
+        commit_tile(cache, slot, vt, t, file + offset);
+        cache->slot_pinned[slot] = 1;
+    }
+    return vt;
+}
+
+
+void close_paged_texture(VirtualTexture* vt)
+{
+    VTCache* cache = vt->cache;
+    std::unique_lock<std::mutex> guard(cache->lock);
+
+    // Drop queued and loaded tiles of this texture, waiting out a read in progress.
+    while (true) {
+        for (size_t i = 0; i < cache->requests.size();) {
+            if (cache->requests[i].tex != vt) { i++; continue; }
+            cache->requests.erase(cache->requests.begin() + i);
+            cache->pending--;
+        }
+        for (size_t i = 0; i < cache->completed.size();) {
+            if (cache->completed[i].tex != vt) { i++; continue; }
+            free(cache->completed[i].data);
+            cache->completed.erase(cache->completed.begin() + i);
+            cache->pending--;
+        }
+        if (cache->loading != vt) break;
+        guard.unlock();
+        std::this_thread::yield();
+        guard.lock();
+    }
+
+    // Release its physical slots and any feedback still pointing at it.
+    for (unsigned int s = 0; s < cache->num_slots; s++) {
+        if (cache->slot_owner[s] != vt) continue;
+        cache->slot_owner[s] = NULL;
+        cache->slot_pinned[s] = 0;
+    }
+    for (size_t i = 0; i < cache->feedback.size();) {
+        if (cache->feedback[i].tex != vt) { i++; continue; }
+        cache->feedback[i] = cache->feedback.back();
+        cache->feedback.pop_back();
+    }
+    guard.unlock();
+
+    munmap(vt->file, vt->file_size);
+    close(vt->fd);
+    delete[] vt->page_table;
+    delete[] vt->tile_state;
+    delete[] vt->requested;
+    delete vt;
+}
+
+int vt_select_mip(VirtualTexture* vt, double uv_area, double pixel_area)
+{
+    // Pick the mip at which one texel covers roughly one pixel.
+    double texel_area = uv_area * vt->header.width * vt->header.height;
+    if (pixel_area <= 0 || texel_area <= pixel_area) return 0;
+    int mip = (int) (0.5 * log2(texel_area / pixel_area));
+    return std::min(mip, (int) vt->header.num_mips - 1);
+}
+
+
+void vt_sample(VirtualTexture* vt, Eigen::Vector2f* texcoord, int mip, uint8_t* rgb)
+{
+    VTCache* cache = vt->cache;
+    unsigned int tile_size = vt->header.tile_size;
+    int w = vt->header.mip_width[mip];
+    int h = vt->header.mip_height[mip];
+
+    // Nearest neighbor texel at the requested mip, with repeat wrapping.
+    int u = (int) floor(w * (*texcoord)(0) + .5) % w;
+    int v = (int) floor(h * (1 - (*texcoord)(1)) + .5) % h;
+    if (u < 0) u += w;
+    if (v < 0) v += h;
+
+    // Record the touched tile in the feedback buffer (once per frame).
+    unsigned int tile = vt->mip_base[mip] + (v / tile_size) * vt->header.tiles_x[mip] + u / tile_size;
+    if (vt->requested[tile] != cache->frame) {
+        vt->requested[tile] = cache->frame;
+        VTFeedback entry = {vt, (uint32_t) mip, tile};
+        cache->feedback.push_back(entry);
+    }
+
+    // Fall back to coarser mips until the tile is resident.
+    while (vt->page_table[tile] < 0) {
+        if (mip + 1 >= (int) vt->header.num_mips) {
+            rgb[0] = rgb[1] = rgb[2] = 0;
+            return;
+        }
+        mip++;
+        u >>= 1;
+        v >>= 1;
+        u = std::min(u, (int) vt->header.mip_width[mip] - 1);
+        v = std::min(v, (int) vt->header.mip_height[mip] - 1);
+        tile = vt->mip_base[mip] + (v / tile_size) * vt->header.tiles_x[mip] + u / tile_size;
+    }
+
+    uint8_t* slot = cache->slots + (size_t) vt->page_table[tile] * cache->tile_bytes;
+    unsigned int i = 3 * ((v % tile_size) * tile_size + (u % tile_size));
+    rgb[0] = slot[i];
+    rgb[1] = slot[i + 1];
+    rgb[2] = slot[i + 2];
+}
+
+
+void vt_update(VTCache* cache)
+{
+    PROFILE_ZONE("vt update");
+    {
+        std::lock_guard<std::mutex> guard(cache->lock);
+
+        // Refresh LRU stamps of resident tiles and queue the missing ones.
+        for (size_t i = 0; i < cache->feedback.size(); i++) {
+            VTFeedback entry = cache->feedback[i];
+            VirtualTexture* vt = entry.tex;
+            int slot = vt->page_table[entry.tile];
+            if (slot >= 0) {
+                cache->slot_last_used[slot] = cache->frame;
+            } else if (vt->tile_state[entry.tile] == VT_TILE_ABSENT && cache->pending < VT_MAX_PENDING) {
+                vt->tile_state[entry.tile] = VT_TILE_PENDING;
+                VTStagedTile req = {vt, entry.tile, NULL};
+                cache->requests.push_back(req);
+                cache->pending++;
+            }
+        }
+        cache->feedback.clear();
+
+        // Commit at most a frame's worth of loaded tiles into the physical cache.
+        // This stays under the lock as textures may be opened or closed from other threads.
+        for (unsigned int n = 0; n < VT_MAX_UPLOADS_PER_FRAME && !cache->completed.empty(); n++) {
+            VTStagedTile staged = cache->completed.front();
+            cache->completed.pop_front();
+            cache->pending--;
+            int slot = acquire_slot(cache);
+            if (slot >= 0) {
+                commit_tile(cache, slot, staged.tex, staged.tile, staged.data);
+            } else {
+                staged.tex->tile_state[staged.tile] = VT_TILE_ABSENT;
+            }
+            free(staged.data);
+        }
+
+        // Loader threads read the frame when they take slots in open_paged_texture.
+        cache->frame++;
+    }
+    cache->wake.notify_one();
+}
@@ -0,0 +1,129 @@
+#ifndef _VTEXTURE_H_
+#define _VTEXTURE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <Eigen/Dense>
+#include "types.h"
+
+
+#define VT_MAGIC "PGTEX01"
+#define VT_VERSION 1
+#define VT_MAX_MIPS 16
+#define VT_DEFAULT_TILE_SIZE 128
+#define VT_MIN_TILE_SIZE 16             // Tile sizes are powers of two within these limits.
+#define VT_MAX_TILE_SIZE 1024
+#define VT_DEFAULT_CACHE_SLOTS 256      // 256 tiles of 128x128 RGB = 12 MB.
+#define VT_MAX_UPLOADS_PER_FRAME 32
+#define VT_MAX_PENDING 128
+#define VT_MIP_BATCH_TEXELS 65536       // Texels downsampled per job.
+
+#define VT_TILE_ABSENT 0
+#define VT_TILE_PENDING 1
+#define VT_TILE_RESIDENT 2
+
+
+// On-disk header of a paged texture (.vtex). Tiles of each mip follow in
+// row-major order, every tile holding tile_size * tile_size RGB texels.
+struct PagedTextureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t num_mips;
+    uint32_t mip_width[VT_MAX_MIPS];
+    uint32_t mip_height[VT_MAX_MIPS];
+    uint32_t tiles_x[VT_MAX_MIPS];
+    uint32_t tiles_y[VT_MAX_MIPS];
+    uint64_t mip_offset[VT_MAX_MIPS];
+};
+
+
+struct VTCache;
+
+
+struct VirtualTexture {
+    int fd;
+    uint8_t* file;                  // Memory-mapped paged texture file.
+    size_t file_size;
+    PagedTextureHeader header;
+    unsigned int tile_bytes;
+    unsigned int num_tiles;
+    unsigned int mip_base[VT_MAX_MIPS];
+    int* page_table;                // Physical cache slot per tile (-1 if absent).
+    uint8_t* tile_state;
+    uint32_t* requested;            // Frame in which each tile was last requested.
+    VTCache* cache;
+};
+
+
+// Feedback entry emitted by the rasterizer for every tile it touched.
+struct VTFeedback {
+    VirtualTexture* tex;
+    uint32_t mip;
+    uint32_t tile;
+};
+
+
+// Tile read from disk by the loader thread, waiting to be committed.
+struct VTStagedTile {
+    VirtualTexture* tex;
+    uint32_t tile;
+    uint8_t* data;
+};
+
+
+// Fixed-size physical tile cache shared by all virtual textures.
+struct VTCache {
+    unsigned int tile_size;
+    unsigned int tile_bytes;
+    unsigned int num_slots;
+    uint8_t* slots;
+    VirtualTexture** slot_owner;
+    uint32_t* slot_tile;
+    uint32_t* slot_last_used;
+    uint8_t* slot_pinned;
+    uint32_t frame;
+    std::vector<VTFeedback> feedback;
+
+    // Background loader state.
+    std::thread loader;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<VTStagedTile> requests;
+    std::deque<VTStagedTile> completed;
+    VirtualTexture* loading;        // Texture the loader is reading from, or NULL.
+    unsigned int pending;
+    bool stop;
+};
+
+
+uint8_t* downsample_rgb(const uint8_t* src, unsigned int w, unsigned int h, unsigned int* out_w, unsigned int* out_h);
+
+bool vt_valid_tile_size(unsigned int tile_size);
+
+int create_paged_texture(const char src_filename[], const char dst_filename[], unsigned int tile_size);
+
+VTCache* create_vt_cache(unsigned int num_slots, unsigned int tile_size);
+
+VTCache* vt_default_cache();
+
+void destroy_vt_cache(VTCache* cache);
+
+VirtualTexture* open_paged_texture(const char filename[], VTCache* cache);
+
+void close_paged_texture(VirtualTexture* vt);
+
+int vt_select_mip(VirtualTexture* vt, double uv_area, double pixel_area);
+
+void vt_sample(VirtualTexture* vt, Eigen::Vector2f* texcoord, int mip, uint8_t* rgb);
+
+void vt_update(VTCache* cache);
+
+
+#endif